@@ -1,100 +1,609 @@
 #include "big_integer.h"
+#include "big_integer_kernels.h"
+#include "big_integer_parallel.h"
 
-#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <ostream>
 #include <stdexcept>
+#include <utility>
 
-big_integer::big_integer()
+namespace
+{
+// 10^19 < 2^64 < 10^20: 19 digits always fit in a limb, which never needs more than 20
+size_t const min_digits_per_limb = 19;
+size_t const max_digits_per_limb = 20;
+
+// yields the limbs of the infinite two's complement form of a signed magnitude,
+// reading each input limb before the caller may overwrite it
+struct twos_complement_reader
+{
+    twos_complement_reader(kernels::limb_t const* data, size_t size, bool negative)
+        : data(data)
+        , size(size)
+        , position(0)
+        , negative(negative)
+        , borrow(1)
+    {}
+
+    kernels::limb_t next()
+    {
+        kernels::limb_t x = position < size ? data[position] : 0;
+        ++position;
+        if (!negative)
+        {
+            return x;
+        }
+        kernels::limb_t d = x - borrow;
+        borrow = x < borrow;
+        return ~d;
+    }
+
+    kernels::limb_t sign() const
+    {
+        return negative ? ~kernels::limb_t(0) : 0;
+    }
+
+private:
+    kernels::limb_t const* data;
+    size_t size;
+    size_t position;
+    bool negative;
+    kernels::limb_t borrow;
+};
+
+// the number of significant bits of a[0..n), a[n - 1] != 0
+size_t bit_length(kernels::limb_t const* a, size_t n)
+{
+    return n * kernels::limb_bits - static_cast<size_t>(__builtin_clzll(a[n - 1]));
+}
+
+// floor(sqrt(a)), corrected from the estimate in double precision
+kernels::limb_t sqrt_limb(kernels::limb_t a)
 {
-    mpz_init(mpz);
+    kernels::limb_t const max_root = 0xffffffff;
+    kernels::limb_t r = static_cast<kernels::limb_t>(std::sqrt(static_cast<double>(a)));
+    while (r > max_root || r * r > a)
+    {
+        --r;
+    }
+    while (r < max_root && (r + 1) * (r + 1) <= a)
+    {
+        ++r;
+    }
+    return r;
 }
 
+// x^k for k >= 1
+big_integer power(big_integer x, unsigned k)
+{
+    big_integer result = x;
+    for (unsigned bit = 1u << (31 - __builtin_clz(k)); bit >>= 1;)
+    {
+        result *= result;
+        if ((k & bit) != 0)
+        {
+            result *= x;
+        }
+    }
+    return result;
+}
+
+// the set of squares modulo m <= 64 as a bit mask
+constexpr uint64_t square_residues(unsigned m)
+{
+    uint64_t mask = 0;
+    for (unsigned i = 0; i != m; ++i)
+    {
+        mask |= uint64_t(1) << (i * i % m);
+    }
+    return mask;
+}
+}
+
+big_integer::big_integer()
+    : negative(false)
+{}
+
 big_integer::big_integer(big_integer const& other)
+    : negative(other.negative)
+    , limbs(other.limbs)
+{}
+
+big_integer::big_integer(big_integer&& other) noexcept
+    : negative(other.negative)
+    , limbs(std::move(other.limbs))
 {
-    mpz_init_set(mpz, other.mpz);
+    other.negative = false;
 }
 
 big_integer::big_integer(int a)
+    : negative(a < 0)
 {
-    mpz_init_set_si(mpz, a);
+    if (a != 0)
+    {
+        limbs.push_back(negative ? 0 - static_cast<limb_t>(a) : static_cast<limb_t>(a));
+    }
 }
 
 big_integer::big_integer(std::string const& str)
+    : negative(false)
 {
-    if (mpz_init_set_str(mpz, str.c_str(), 10))
+    size_t pos = 0;
+    if (!str.empty() && (str[0] == '-' || str[0] == '+'))
+    {
+        pos = 1;
+    }
+    if (pos == str.size())
     {
-        mpz_clear(mpz);
         throw std::runtime_error("invalid string");
     }
+
+    for (size_t i = pos; i != str.size(); ++i)
+    {
+        if (str[i] < '0' || str[i] > '9')
+        {
+            throw std::runtime_error("invalid string");
+        }
+    }
+    size_t length = str.size() - pos;
+    limbs.resize(length / min_digits_per_limb + 1);
+    limbs.resize(kernels::from_decimal(limbs.data(), str.data() + pos, length));
+    negative = str[0] == '-';
+    trim();
 }
 
-big_integer::~big_integer()
+big_integer::big_integer(product_expression const& product)
+    : negative(false)
 {
-    mpz_clear(mpz);
+    multiply(product.a, product.b);
 }
 
+big_integer::~big_integer()
+{}
+
 big_integer& big_integer::operator=(big_integer const& other)
 {
-    mpz_set(mpz, other.mpz);
+    negative = other.negative;
+    limbs = other.limbs;
+    return *this;
+}
+
+big_integer& big_integer::operator=(big_integer&& other) noexcept
+{
+    negative = other.negative;
+    limbs = std::move(other.limbs);
+    other.negative = false;
     return *this;
 }
 
+big_integer& big_integer::operator=(product_expression const& product)
+{
+    multiply(product.a, product.b);
+    return *this;
+}
+
+void big_integer::trim()
+{
+    limbs.resize(kernels::normalized_size(limbs.data(), limbs.size()));
+    if (limbs.empty())
+    {
+        negative = false;
+    }
+}
+
+int big_integer::compare_magnitude(big_integer const& rhs) const
+{
+    return kernels::cmp(limbs.data(), limbs.size(), rhs.limbs.data(), rhs.limbs.size());
+}
+
+int big_integer::compare(big_integer const& a, big_integer const& b)
+{
+    if (a.negative != b.negative)
+    {
+        return a.negative ? -1 : 1;
+    }
+    int c = a.compare_magnitude(b);
+    return a.negative ? -c : c;
+}
+
+int big_integer::compare(big_integer const& a, bool b_negative, limb_t b)
+{
+    b_negative = b_negative && b != 0;
+    if (a.negative != b_negative)
+    {
+        return a.negative ? -1 : 1;
+    }
+    int c = kernels::cmp(a.limbs.data(), a.limbs.size(), &b, b != 0 ? 1 : 0);
+    return a.negative ? -c : c;
+}
+
+void big_integer::add_magnitude(limb_t const* rhs, size_t rhs_size)
+{
+    size_t n = std::max(limbs.size(), rhs_size);
+    limbs.resize(n);
+    limb_t carry = kernels::add(limbs.data(), limbs.data(), n, rhs, rhs_size);
+    if (carry != 0)
+    {
+        limbs.push_back(carry);
+    }
+}
+
+void big_integer::sub_magnitude(limb_t const* rhs, size_t rhs_size)
+{
+    size_t n = limbs.size();
+    int c = kernels::cmp(limbs.data(), n, rhs, rhs_size);
+    if (c == 0)
+    {
+        limbs.clear();
+        negative = false;
+        return;
+    }
+    if (c > 0)
+    {
+        kernels::sub(limbs.data(), limbs.data(), n, rhs, rhs_size);
+    }
+    else
+    {
+        limbs.resize(rhs_size);
+        kernels::sub(limbs.data(), rhs, rhs_size, limbs.data(), n);
+        negative = !negative;
+    }
+    trim();
+}
+
+void big_integer::multiply(big_integer const& a, big_integer const& b)
+{
+    big_integer const* x = &a;
+    big_integer const* y = &b;
+    if (x->limbs.size() < y->limbs.size())
+    {
+        std::swap(x, y);
+    }
+    size_t an = x->limbs.size();
+    size_t bn = y->limbs.size();
+    bool product_negative = a.negative != b.negative;
+    if (bn == 0)
+    {
+        limbs.clear();
+        negative = false;
+        return;
+    }
+
+    // small products go through the stack so that inline values stay inline,
+    // others are written straight into this object unless it is an operand
+    limb_t local[4 * storage_t::inline_capacity];
+    storage_t product;
+    if (an + bn <= sizeof(local) / sizeof(local[0]))
+    {
+        kernels::mul(local, x->limbs.data(), an, y->limbs.data(), bn);
+        limbs.assign(local, local + kernels::normalized_size(local, an + bn));
+    }
+    else if (this != &a && this != &b)
+    {
+        limbs.clear();
+        limbs.resize(an + bn);
+        kernels::mul(limbs.data(), x->limbs.data(), an, y->limbs.data(), bn);
+    }
+    else
+    {
+        product.resize(an + bn);
+        kernels::mul(product.data(), x->limbs.data(), an, y->limbs.data(), bn);
+        limbs.swap(product);
+    }
+    negative = product_negative;
+    trim();
+}
+
+void big_integer::add_scalar(bool rhs_negative, limb_t rhs)
+{
+    size_t n = limbs.size();
+    if (rhs == 0)
+    {
+        return;
+    }
+    if (n == 0)
+    {
+        limbs.push_back(rhs);
+        negative = rhs_negative;
+        return;
+    }
+    if (negative == rhs_negative)
+    {
+        if (kernels::add_1(limbs.data(), limbs.data(), n, rhs) != 0)
+        {
+            limbs.push_back(1);
+        }
+        return;
+    }
+    if (n == 1 && limbs[0] < rhs)
+    {
+        limbs[0] = rhs - limbs[0];
+        negative = rhs_negative;
+        return;
+    }
+    kernels::sub_1(limbs.data(), limbs.data(), n, rhs);
+    trim();
+}
+
+void big_integer::mul_scalar(bool rhs_negative, limb_t rhs)
+{
+    if (rhs == 0 || limbs.empty())
+    {
+        limbs.clear();
+        negative = false;
+        return;
+    }
+    limb_t carry = kernels::mul_1(limbs.data(), limbs.data(), limbs.size(), rhs);
+    if (carry != 0)
+    {
+        limbs.push_back(carry);
+    }
+    negative = negative != rhs_negative;
+}
+
+void big_integer::div_scalar(bool rhs_negative, limb_t rhs, bool remainder)
+{
+    if (rhs == 0)
+    {
+        throw std::runtime_error("division by zero");
+    }
+    limb_t r = kernels::divrem_1(limbs.data(), limbs.data(), limbs.size(), rhs);
+    if (remainder)
+    {
+        limbs.clear();
+        if (r != 0)
+        {
+            limbs.push_back(r);
+        }
+    }
+    else
+    {
+        negative = negative != rhs_negative;
+    }
+    trim();
+}
+
+void big_integer::add_product(product_expression const& product, bool subtract)
+{
+    // an operand that is this object is read from a copy, as the product is
+    // accumulated over its limbs
+    if (this == &product.a || this == &product.b)
+    {
+        big_integer operand(*this);
+        add_product({this == &product.a ? operand : product.a, this == &product.b ? operand : product.b}, subtract);
+        return;
+    }
+    add_product(product.a.limbs.data(), product.a.limbs.size(), product.b.limbs.data(), product.b.limbs.size(),
+                (product.a.negative != product.b.negative) != subtract);
+}
+
+void big_integer::add_product(limb_t const* a, size_t an, limb_t const* b, size_t bn, bool product_negative)
+{
+    if (an < bn)
+    {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    if (bn == 0)
+    {
+        return;
+    }
+
+    size_t n = limbs.size();
+    size_t size = std::max(n, an + bn);
+    limbs.resize(size);
+    if (n == 0 || negative == product_negative)
+    {
+        limb_t carry = kernels::addmul(limbs.data(), size, a, an, b, bn);
+        if (carry != 0)
+        {
+            limbs.push_back(carry);
+        }
+        negative = product_negative;
+    }
+    else if (kernels::submul(limbs.data(), size, a, an, b, bn))
+    {
+        negative = product_negative;
+    }
+    trim();
+}
+
+void big_integer::add_scalar_product(big_integer const& a, bool b_negative, limb_t b, bool subtract)
+{
+    if (this == &a)
+    {
+        big_integer operand(a);
+        add_scalar_product(operand, b_negative, b, subtract);
+        return;
+    }
+    add_product(a.limbs.data(), a.limbs.size(), &b, b != 0 ? 1 : 0, (a.negative != b_negative) != subtract);
+}
+
+template<typename Op>
+void big_integer::apply_bitwise(big_integer const& rhs, Op op)
+{
+    size_t an = limbs.size();
+    size_t bn = rhs.limbs.size();
+    size_t n = std::max(an, bn);
+    limbs.resize(n);
+    twos_complement_reader a(limbs.data(), an, negative);
+    twos_complement_reader b(rhs.limbs.data(), bn, rhs.negative);
+    for (size_t i = 0; i != n; ++i)
+    {
+        limb_t x = a.next();
+        limbs[i] = op(x, b.next());
+    }
+    negative = op(a.sign(), b.sign()) != 0;
+    if (negative)
+    {
+        for (size_t i = 0; i != n; ++i)
+        {
+            limbs[i] = ~limbs[i];
+        }
+        if (kernels::add_1(limbs.data(), limbs.data(), n, 1) != 0)
+        {
+            limbs.push_back(1);
+        }
+    }
+    trim();
+}
+
 big_integer& big_integer::operator+=(big_integer const& rhs)
 {
-    mpz_add(mpz, mpz, rhs.mpz);
+    if (negative == rhs.negative)
+    {
+        add_magnitude(rhs.limbs.data(), rhs.limbs.size());
+    }
+    else
+    {
+        sub_magnitude(rhs.limbs.data(), rhs.limbs.size());
+    }
     return *this;
 }
 
 big_integer& big_integer::operator-=(big_integer const& rhs)
 {
-    mpz_sub(mpz, mpz, rhs.mpz);
+    if (negative != rhs.negative)
+    {
+        add_magnitude(rhs.limbs.data(), rhs.limbs.size());
+    }
+    else
+    {
+        sub_magnitude(rhs.limbs.data(), rhs.limbs.size());
+    }
     return *this;
 }
 
 big_integer& big_integer::operator*=(big_integer const& rhs)
 {
-    mpz_mul(mpz, mpz, rhs.mpz);
+    multiply(*this, rhs);
     return *this;
 }
 
 big_integer& big_integer::operator/=(big_integer const& rhs)
 {
-    mpz_tdiv_q(mpz, mpz, rhs.mpz);
+    divmod(*this, rhs, this, nullptr);
     return *this;
 }
 
 big_integer& big_integer::operator%=(big_integer const& rhs)
 {
-    mpz_tdiv_r(mpz, mpz, rhs.mpz);
+    divmod(*this, rhs, nullptr, this);
+    return *this;
+}
+
+big_integer& big_integer::operator+=(product_expression const& rhs)
+{
+    add_product(rhs, false);
+    return *this;
+}
+
+big_integer& big_integer::operator-=(product_expression const& rhs)
+{
+    add_product(rhs, true);
+    return *this;
+}
+
+big_integer& big_integer::addmul(big_integer const& a, big_integer const& b)
+{
+    add_product({a, b}, false);
+    return *this;
+}
+
+big_integer& big_integer::submul(big_integer const& a, big_integer const& b)
+{
+    add_product({a, b}, true);
     return *this;
 }
 
 big_integer& big_integer::operator&=(big_integer const& rhs)
 {
-    mpz_and(mpz, mpz, rhs.mpz);
+    apply_bitwise(rhs, [](limb_t a, limb_t b) { return a & b; });
     return *this;
 }
 
 big_integer& big_integer::operator|=(big_integer const& rhs)
 {
-    mpz_ior(mpz, mpz, rhs.mpz);
+    apply_bitwise(rhs, [](limb_t a, limb_t b) { return a | b; });
     return *this;
 }
 
 big_integer& big_integer::operator^=(big_integer const& rhs)
 {
-    mpz_xor(mpz, mpz, rhs.mpz);
+    apply_bitwise(rhs, [](limb_t a, limb_t b) { return a ^ b; });
     return *this;
 }
 
 big_integer& big_integer::operator<<=(int rhs)
 {
-    mpz_mul_2exp(mpz, mpz, rhs);
+    if (rhs < 0)
+    {
+        return *this >>= -rhs;
+    }
+    if (limbs.empty())
+    {
+        return *this;
+    }
+    size_t an = limbs.size();
+    size_t whole = static_cast<size_t>(rhs) / kernels::limb_bits;
+    unsigned bits = static_cast<unsigned>(rhs) % kernels::limb_bits;
+    limbs.resize(an + whole);
+    if (bits != 0)
+    {
+        limb_t out = kernels::lshift(limbs.data() + whole, limbs.data(), an, bits);
+        if (out != 0)
+        {
+            limbs.push_back(out);
+        }
+    }
+    else
+    {
+        std::copy_backward(limbs.begin(), limbs.begin() + an, limbs.begin() + an + whole);
+    }
+    std::fill(limbs.begin(), limbs.begin() + whole, 0);
     return *this;
 }
 
 big_integer& big_integer::operator>>=(int rhs)
 {
-    mpz_div_2exp(mpz, mpz, rhs);
+    if (rhs < 0)
+    {
+        return *this <<= -rhs;
+    }
+    size_t an = limbs.size();
+    size_t whole = static_cast<size_t>(rhs) / kernels::limb_bits;
+    unsigned bits = static_cast<unsigned>(rhs) % kernels::limb_bits;
+    if (whole >= an)
+    {
+        return *this = negative ? -1 : 0;
+    }
+
+    // shifting rounds towards negative infinity, as for two's complement
+    bool round_up = false;
+    if (negative)
+    {
+        round_up = kernels::normalized_size(limbs.data(), whole) != 0
+                   || (bits != 0 && (limbs[whole] << (kernels::limb_bits - bits)) != 0);
+    }
+    if (bits != 0)
+    {
+        kernels::rshift(limbs.data(), limbs.data() + whole, an - whole, bits);
+    }
+    else
+    {
+        std::copy(limbs.begin() + whole, limbs.end(), limbs.begin());
+    }
+    limbs.resize(an - whole);
+    trim();
+    if (round_up)
+    {
+        negative = true;
+        if (kernels::add_1(limbs.data(), limbs.data(), limbs.size(), 1) != 0)
+        {
+            limbs.push_back(1);
+        }
+    }
     return *this;
 }
 
@@ -103,24 +612,37 @@ big_integer big_integer::operator+() const
     return *this;
 }
 
-big_integer big_integer::operator-() const
+big_integer big_integer::operator-() const&
 {
-    big_integer r;
-    mpz_neg(r.mpz, mpz);
-    return r;
+    big_integer r = *this;
+    return -std::move(r);
 }
 
-big_integer big_integer::operator~() const
+big_integer big_integer::operator-() &&
 {
-    big_integer r;
-    mpz_com(r.mpz, mpz);
+    if (!limbs.empty())
+    {
+        negative = !negative;
+    }
+    return std::move(*this);
+}
+
+big_integer big_integer::operator~() const&
+{
+    big_integer r = *this;
+    return ~std::move(r);
+}
+
+big_integer big_integer::operator~() &&
+{
+    big_integer r = -std::move(*this);
+    --r;
     return r;
 }
 
 big_integer& big_integer::operator++()
 {
-    mpz_add_ui(mpz, mpz, 1);
-    return *this;
+    return *this += 1;
 }
 
 big_integer big_integer::operator++(int)
@@ -132,8 +654,7 @@ big_integer big_integer::operator++(int)
 
 big_integer& big_integer::operator--()
 {
-    mpz_sub_ui(mpz, mpz, 1);
-    return *this;
+    return *this -= 1;
 }
 
 big_integer big_integer::operator--(int)
@@ -145,94 +666,615 @@ big_integer big_integer::operator--(int)
 
 big_integer operator+(big_integer a, big_integer const& b)
 {
-    return a += b;
+    a += b;
+    return a;
 }
 
 big_integer operator-(big_integer a, big_integer const& b)
 {
-    return a -= b;
+    a -= b;
+    return a;
+}
+
+big_integer::product_expression operator*(big_integer const& a, big_integer const& b)
+{
+    return {a, b};
+}
+
+// a temporary would not outlive an expression that referenced it
+big_integer operator*(big_integer&& a, big_integer const& b)
+{
+    big_integer r;
+    mul(r, a, b);
+    return r;
+}
+
+big_integer operator*(big_integer const& a, big_integer&& b)
+{
+    return std::move(b) * a;
+}
+
+big_integer operator*(big_integer&& a, big_integer&& b)
+{
+    return std::move(a) * static_cast<big_integer const&>(b);
 }
 
-big_integer operator*(big_integer a, big_integer const& b)
+void mul(big_integer& r, big_integer const& a, big_integer const& b)
 {
-    return a *= b;
+    r.multiply(a, b);
+}
+
+big_integer::product_expression::product_expression(big_integer const& a, big_integer const& b)
+    : a(a)
+    , b(b)
+{
+}
+
+big_integer big_integer::product_expression::operator+() const
+{
+    return *this;
+}
+
+big_integer big_integer::product_expression::operator-() const
+{
+    return -big_integer(*this);
+}
+
+big_integer big_integer::product_expression::operator~() const
+{
+    return ~big_integer(*this);
 }
 
 big_integer operator/(big_integer a, big_integer const& b)
 {
-    return a /= b;
+    a /= b;
+    return a;
 }
 
 big_integer operator%(big_integer a, big_integer const& b)
 {
-    return a %= b;
+    a %= b;
+    return a;
+}
+
+std::pair<big_integer, big_integer> divmod(big_integer const& a, big_integer const& b)
+{
+    std::pair<big_integer, big_integer> result;
+    divmod(a, b, &result.first, &result.second);
+    return result;
+}
+
+void divmod(big_integer const& a, big_integer const& b, big_integer* quotient, big_integer* remainder)
+{
+    if (b.limbs.empty())
+    {
+        throw std::runtime_error("division by zero");
+    }
+    bool quotient_negative = a.negative != b.negative;
+    bool remainder_negative = a.negative;
+    if (a.compare_magnitude(b) < 0)
+    {
+        if (remainder != nullptr)
+        {
+            *remainder = a;
+        }
+        if (quotient != nullptr)
+        {
+            *quotient = 0;
+        }
+        return;
+    }
+
+    size_t an = a.limbs.size();
+    size_t dn = b.limbs.size();
+    // an output the caller does not want stays in the scratch of divrem
+    big_integer::storage_t q(quotient != nullptr ? an - dn + 1 : 0);
+    big_integer::storage_t r(remainder != nullptr ? dn : 0);
+    kernels::divrem(quotient != nullptr ? q.data() : nullptr, remainder != nullptr ? r.data() : nullptr,
+                    a.limbs.data(), an, b.limbs.data(), dn);
+    if (quotient != nullptr)
+    {
+        quotient->limbs.swap(q);
+        quotient->negative = quotient_negative;
+        quotient->trim();
+    }
+    if (remainder != nullptr)
+    {
+        remainder->limbs.swap(r);
+        remainder->negative = remainder_negative;
+        remainder->trim();
+    }
+}
+
+big_integer gcd(big_integer const& a, big_integer const& b)
+{
+    big_integer result;
+    if (a.limbs.empty() || b.limbs.empty())
+    {
+        result = a.limbs.empty() ? b : a;
+        result.negative = false;
+        return result;
+    }
+    result.limbs.resize(std::min(a.limbs.size(), b.limbs.size()));
+    result.limbs.resize(kernels::gcd(result.limbs.data(), a.limbs.data(), a.limbs.size(), b.limbs.data(),
+                                     b.limbs.size()));
+    return result;
+}
+
+big_integer lcm(big_integer const& a, big_integer const& b)
+{
+    if (a == 0 || b == 0)
+    {
+        return big_integer();
+    }
+    big_integer result = a / gcd(a, b) * b;
+    return result < 0 ? -result : result;
+}
+
+big_integer gcdext(big_integer const& a, big_integer const& b, big_integer* s, big_integer* t)
+{
+    big_integer g;
+    big_integer x;
+    if (b.limbs.empty() || a.limbs.empty())
+    {
+        g = b.limbs.empty() ? a : b;
+        g.negative = false;
+        if (b.limbs.empty() && !a.limbs.empty())
+        {
+            x = a.negative ? -1 : 1;
+        }
+    }
+    else
+    {
+        size_t an = a.limbs.size();
+        size_t bn = b.limbs.size();
+        size_t xn;
+        bool x_negative;
+        g.limbs.resize(std::min(an, bn));
+        x.limbs.resize(bn);
+        g.limbs.resize(kernels::gcdext(g.limbs.data(), x.limbs.data(), &xn, &x_negative, a.limbs.data(), an,
+                                       b.limbs.data(), bn));
+        x.limbs.resize(xn);
+        x.negative = xn != 0 && x_negative != a.negative;
+
+        // the cofactors are only determined modulo b / g and a / g; take the
+        // one of least magnitude, and sgn(a) between 1 and -1
+        big_integer period = b / g;
+        period.negative = false;
+        if (period == 2)
+        {
+            x = a.negative ? -1 : 1;
+        }
+        else if ((x.negative ? -x : x) * 2 >= period)
+        {
+            x %= period;
+            if (x * 2 > period)
+            {
+                x -= period;
+            }
+            else if (x * 2 < -period)
+            {
+                x += period;
+            }
+        }
+    }
+    if (t != nullptr)
+    {
+        *t = b.limbs.empty() ? big_integer() : (g - a * x) / b;
+    }
+    if (s != nullptr)
+    {
+        *s = std::move(x);
+    }
+    return g;
+}
+
+big_integer modinv(big_integer const& a, big_integer const& modulus)
+{
+    if (modulus <= 0)
+    {
+        throw std::runtime_error("invalid modulus");
+    }
+    big_integer s;
+    if (gcdext(a, modulus, &s, nullptr) != 1)
+    {
+        throw std::runtime_error("not invertible");
+    }
+    if (s < 0)
+    {
+        s += modulus;
+    }
+    return s;
+}
+
+// floor(sqrt(a)) and a - floor(sqrt(a))^2 for a >= 0 of the given bit length,
+// by Zimmermann's Karatsuba square root: with a = a_h 2^(2j) + a_1 2^j + a_0
+// and a_h >= 2^(2j - 2), the root s' and remainder r' of a_h give the root
+// of a up to a correction of at most one from the quotient of
+// r' 2^j + a_1 by 2 s', which only has j bits
+big_integer big_integer::sqrt_remainder(big_integer const& a, size_t bits, big_integer& remainder)
+{
+    big_integer s;
+    if (bits <= kernels::limb_bits)
+    {
+        limb_t x = a.limbs.empty() ? 0 : a.limbs[0];
+        limb_t root = sqrt_limb(x);
+        if (root != 0)
+        {
+            s.limbs.push_back(root);
+        }
+        remainder = big_integer();
+        if (x != root * root)
+        {
+            remainder.limbs.push_back(x - root * root);
+        }
+        return s;
+    }
+    int j = static_cast<int>((bits + 1) / 4);
+    big_integer high = a >> (2 * j);
+    big_integer r;
+    s = sqrt_remainder(high, bits - 2 * static_cast<size_t>(j), r);
+    big_integer low = a - (high << (2 * j));
+    big_integer a1 = low >> j;
+    big_integer q;
+    r <<= j;
+    r += a1;
+    divmod(r, s << 1, &q, &r);
+    s <<= j;
+    s += q;
+    remainder = (r << j) + (low - (a1 << j)) - q * q;
+    while (remainder < 0)
+    {
+        remainder += s;
+        --s;
+        remainder += s;
+    }
+    return s;
+}
+
+big_integer isqrt(big_integer const& a)
+{
+    if (a.negative)
+    {
+        throw std::runtime_error("invalid root");
+    }
+    if (a.limbs.empty())
+    {
+        return a;
+    }
+    big_integer remainder;
+    return big_integer::sqrt_remainder(a, bit_length(a.limbs.data(), a.limbs.size()), remainder);
+}
+
+// The k-th root recurses on the leading bits of a: the root x' of a / 2^(k j)
+// gives (x' + 1) 2^j, within 2^j above the root of a, and one Newton step from
+// there leaves an error below 1, so the cost stays within a constant number of
+// multiplications and divisions of the size of a.
+big_integer iroot(big_integer const& a, unsigned k)
+{
+    if (k == 0 || (a.negative && k % 2 == 0))
+    {
+        throw std::runtime_error("invalid root");
+    }
+    if (a.negative)
+    {
+        return -iroot(-a, k);
+    }
+    if (k == 1 || a.limbs.empty())
+    {
+        return a;
+    }
+    if (k == 2)
+    {
+        return isqrt(a);
+    }
+    size_t bits = bit_length(a.limbs.data(), a.limbs.size());
+    if (bits <= k)
+    {
+        return 1;
+    }
+
+    // the Newton step from x to the root r errs by about (k - 1) (x - r)^2 / (2 r)
+    size_t log_k = 32 - static_cast<size_t>(__builtin_clz(k - 1));
+    size_t root_bits = (bits - 1) / k;
+    big_integer x;
+    if (root_bits >= log_k + 4)
+    {
+        int j = static_cast<int>((root_bits - log_k) / 2 - 1);
+        x = (iroot(a >> static_cast<int>(k * static_cast<unsigned>(j)), k) + 1) << j;
+        x = (x * (k - 1) + a / power(x, k - 1)) / k;
+    }
+    else
+    {
+        // Newton's iteration from above decreases until it reaches the root
+        x = big_integer(1) << static_cast<int>(root_bits + 1);
+        for (;;)
+        {
+            big_integer y = (x * (k - 1) + a / power(x, k - 1)) / k;
+            if (y >= x)
+            {
+                return x;
+            }
+            x = std::move(y);
+        }
+    }
+    while (power(x, k) > a)
+    {
+        --x;
+    }
+    return x;
+}
+
+bool is_perfect_square(big_integer const& a)
+{
+    if (a.negative)
+    {
+        return false;
+    }
+    if (a.limbs.empty())
+    {
+        return true;
+    }
+
+    // a quarter of the residues modulo 64 and 63 are squares and about half
+    // of those modulo 17 and 11, which rejects all but 1.5% of non-squares
+    // before the root is taken
+    uint64_t const mod_64 = square_residues(64);
+    uint64_t const mod_63 = square_residues(63);
+    uint64_t const mod_17 = square_residues(17);
+    uint64_t const mod_11 = square_residues(11);
+    if ((mod_64 >> (a.limbs[0] % 64) & 1) == 0)
+    {
+        return false;
+    }
+    big_integer residue = a % (63 * 17 * 11);
+    kernels::limb_t r = residue.limbs.empty() ? 0 : residue.limbs[0];
+    if ((mod_63 >> (r % 63) & 1) == 0 || (mod_17 >> (r % 17) & 1) == 0 || (mod_11 >> (r % 11) & 1) == 0)
+    {
+        return false;
+    }
+    big_integer remainder;
+    big_integer::sqrt_remainder(a, bit_length(a.limbs.data(), a.limbs.size()), remainder);
+    return remainder.limbs.empty();
+}
+
+big_integer product(std::vector<big_integer> factors)
+{
+    if (factors.empty())
+    {
+        return 1;
+    }
+    for (big_integer const& x : factors)
+    {
+        if (x.limbs.empty())
+        {
+            return big_integer();
+        }
+    }
+
+    // small factors are multiplied together while their product fits in a limb
+    size_t count = 0;
+    for (size_t i = 0; i != factors.size(); ++i)
+    {
+        big_integer& x = factors[i];
+        if (count != 0 && x.limbs.size() == 1 && factors[count - 1].limbs.size() == 1)
+        {
+            big_integer& last = factors[count - 1];
+            kernels::double_limb_t p = static_cast<kernels::double_limb_t>(last.limbs[0]) * x.limbs[0];
+            if ((p >> kernels::limb_bits) == 0)
+            {
+                last.limbs[0] = static_cast<kernels::limb_t>(p);
+                last.negative = last.negative != x.negative;
+                continue;
+            }
+        }
+        std::swap(factors[count++], x);
+    }
+    factors.resize(count);
+
+    // factors of similar sizes are paired, so that the tree stays balanced;
+    // each level is written into the objects of the level before the last,
+    // whose buffers it reuses
+    std::stable_sort(factors.begin(), factors.end(),
+                     [](big_integer const& x, big_integer const& y) { return x.limbs.size() < y.limbs.size(); });
+    std::vector<big_integer> next;
+    while (factors.size() != 1)
+    {
+        size_t pairs = factors.size() / 2;
+        size_t limbs = 0;
+        for (big_integer const& x : factors)
+        {
+            limbs += x.limbs.size();
+        }
+        next.resize(factors.size() - pairs);
+        // slices of pairs with parallel_threshold limbs between them
+        size_t grain = std::max<size_t>(1, pairs * kernels::parallel_threshold / limbs);
+        kernels::parallel_for(pairs, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i != end; ++i)
+            {
+                next[i].multiply(factors[2 * i], factors[2 * i + 1]);
+            }
+        });
+        if (factors.size() % 2 != 0)
+        {
+            std::swap(next.back(), factors.back());
+        }
+        factors.swap(next);
+    }
+    return std::move(factors[0]);
 }
 
 big_integer operator&(big_integer a, big_integer const& b)
 {
-    return a &= b;
+    a &= b;
+    return a;
 }
 
 big_integer operator|(big_integer a, big_integer const& b)
 {
-    return a |= b;
+    a |= b;
+    return a;
 }
 
 big_integer operator^(big_integer a, big_integer const& b)
 {
-    return a ^= b;
+    a ^= b;
+    return a;
 }
 
 big_integer operator<<(big_integer a, int b)
 {
-    return a <<= b;
+    a <<= b;
+    return a;
 }
 
 big_integer operator>>(big_integer a, int b)
 {
-    return a >>= b;
+    a >>= b;
+    return a;
+}
+
+big_integer operator+(big_integer const& a, big_integer&& b)
+{
+    b += a;
+    return std::move(b);
+}
+
+big_integer operator-(big_integer const& a, big_integer&& b)
+{
+    b -= a;
+    return -std::move(b);
+}
+
+big_integer operator&(big_integer const& a, big_integer&& b)
+{
+    b &= a;
+    return std::move(b);
+}
+
+big_integer operator|(big_integer const& a, big_integer&& b)
+{
+    b |= a;
+    return std::move(b);
+}
+
+big_integer operator^(big_integer const& a, big_integer&& b)
+{
+    b ^= a;
+    return std::move(b);
+}
+
+big_integer operator+(big_integer::product_expression const& a, big_integer const& b)
+{
+    big_integer r;
+    r.limbs.reserve(std::max(a.a.limbs.size() + a.b.limbs.size(), b.limbs.size()) + 1);
+    r.multiply(a.a, a.b);
+    r += b;
+    return r;
+}
+
+big_integer operator+(big_integer::product_expression const& a, big_integer&& b)
+{
+    b += a;
+    return std::move(b);
+}
+
+big_integer operator+(big_integer const& a, big_integer::product_expression const& b)
+{
+    return b + a;
+}
+
+big_integer operator+(big_integer&& a, big_integer::product_expression const& b)
+{
+    a += b;
+    return std::move(a);
+}
+
+big_integer operator+(big_integer::product_expression const& a, big_integer::product_expression const& b)
+{
+    big_integer r;
+    r.limbs.reserve(std::max(a.a.limbs.size() + a.b.limbs.size(), b.a.limbs.size() + b.b.limbs.size()) + 1);
+    r.multiply(a.a, a.b);
+    r += b;
+    return r;
+}
+
+big_integer operator-(big_integer::product_expression const& a, big_integer const& b)
+{
+    big_integer r;
+    r.limbs.reserve(std::max(a.a.limbs.size() + a.b.limbs.size(), b.limbs.size()) + 1);
+    r.multiply(a.a, a.b);
+    r -= b;
+    return r;
+}
+
+big_integer operator-(big_integer::product_expression const& a, big_integer&& b)
+{
+    b -= a;
+    return -std::move(b);
+}
+
+big_integer operator-(big_integer const& a, big_integer::product_expression const& b)
+{
+    return -(b - a);
+}
+
+big_integer operator-(big_integer&& a, big_integer::product_expression const& b)
+{
+    a -= b;
+    return std::move(a);
+}
+
+big_integer operator-(big_integer::product_expression const& a, big_integer::product_expression const& b)
+{
+    big_integer r;
+    r.limbs.reserve(std::max(a.a.limbs.size() + a.b.limbs.size(), b.a.limbs.size() + b.b.limbs.size()) + 1);
+    r.multiply(a.a, a.b);
+    r -= b;
+    return r;
 }
 
 bool operator==(big_integer const& a, big_integer const& b)
 {
-    return mpz_cmp(a.mpz, b.mpz) == 0;
+    return big_integer::compare(a, b) == 0;
 }
 
 bool operator!=(big_integer const& a, big_integer const& b)
 {
-    return mpz_cmp(a.mpz, b.mpz) != 0;
+    return big_integer::compare(a, b) != 0;
 }
 
 bool operator<(big_integer const& a, big_integer const& b)
 {
-    return mpz_cmp(a.mpz, b.mpz) < 0;
+    return big_integer::compare(a, b) < 0;
 }
 
 bool operator>(big_integer const& a, big_integer const& b)
 {
-    return mpz_cmp(a.mpz, b.mpz) > 0;
+    return big_integer::compare(a, b) > 0;
 }
 
 bool operator<=(big_integer const& a, big_integer const& b)
 {
-    return mpz_cmp(a.mpz, b.mpz) <= 0;
+    return big_integer::compare(a, b) <= 0;
 }
 
 bool operator>=(big_integer const& a, big_integer const& b)
 {
-    return mpz_cmp(a.mpz, b.mpz) >= 0;
+    return big_integer::compare(a, b) >= 0;
 }
 
 std::string to_string(big_integer const& a)
 {
-    char* tmp = mpz_get_str(NULL, 10, a.mpz);
-    std::string res = tmp;
-
-    void (*freefunc)(void*, size_t);
-    mp_get_memory_functions (NULL, NULL, &freefunc);
-
-    freefunc(tmp, strlen(tmp) + 1);
+    if (a.limbs.empty())
+    {
+        return "0";
+    }
 
+    std::string res(max_digits_per_limb * a.limbs.size() + 1, '-');
+    size_t sign = a.negative ? 1 : 0;
+    size_t digits = kernels::to_decimal(&res[sign], a.limbs.data(), a.limbs.size());
+    res.resize(sign + digits);
     return res;
 }
 
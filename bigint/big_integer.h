@@ -2,18 +2,54 @@
 #define BIG_INTEGER_H
 
 #include <cstddef>
-#include <gmp.h>
+#include <cstdint>
 #include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "big_integer_storage.h"
+
+template<size_t Bits, bool Signed>
+struct fixed_big_integer;
 
 struct big_integer
 {
+    // a * b of two lvalues, evaluated when it is converted to a big_integer, or
+    // accumulated straight into the destination when it is added to or
+    // subtracted from one. The operands are referenced, so the value depends
+    // on them at the point of use; the expression can be neither copied nor
+    // moved, which keeps it from being stored (auto p = a * b does not
+    // compile) and used after they change. A product with a temporary operand
+    // is a big_integer.
+    struct product_expression
+    {
+        product_expression(big_integer const& a, big_integer const& b);
+        product_expression(product_expression const&) = delete;
+        product_expression(product_expression&&) = delete;
+        product_expression& operator=(product_expression const&) = delete;
+        product_expression& operator=(product_expression&&) = delete;
+
+        big_integer const& a;
+        big_integer const& b;
+
+        big_integer operator+() const;
+        big_integer operator-() const;
+        big_integer operator~() const;
+    };
+
     big_integer();
     big_integer(big_integer const& other);
+    big_integer(big_integer&& other) noexcept;
     big_integer(int a);
     explicit big_integer(std::string const& str);
+    big_integer(product_expression const& product);
     ~big_integer();
 
     big_integer& operator=(big_integer const& other);
+    big_integer& operator=(big_integer&& other) noexcept;
+    big_integer& operator=(product_expression const& product);
 
     big_integer& operator+=(big_integer const& rhs);
     big_integer& operator-=(big_integer const& rhs);
@@ -21,6 +57,20 @@ struct big_integer
     big_integer& operator/=(big_integer const& rhs);
     big_integer& operator%=(big_integer const& rhs);
 
+    big_integer& operator+=(product_expression const& rhs);
+    big_integer& operator-=(product_expression const& rhs);
+
+    // this += a * b and this -= a * b, the same as += and -= with a * b: the
+    // product is accumulated into this object's limbs, one by a few limbs row
+    // by row and a larger one through the scratch space of the multiplication,
+    // never through a temporary big_integer. a or b may be this object.
+    big_integer& addmul(big_integer const& a, big_integer const& b);
+    big_integer& submul(big_integer const& a, big_integer const& b);
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    big_integer& addmul(big_integer const& a, T b);
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    big_integer& submul(big_integer const& a, T b);
+
     big_integer& operator&=(big_integer const& rhs);
     big_integer& operator|=(big_integer const& rhs);
     big_integer& operator^=(big_integer const& rhs);
@@ -28,9 +78,24 @@ struct big_integer
     big_integer& operator<<=(int rhs);
     big_integer& operator>>=(int rhs);
 
+    // built-in integer operands go to single-limb kernels instead of being
+    // converted to a big_integer first
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    big_integer& operator+=(T rhs);
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    big_integer& operator-=(T rhs);
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    big_integer& operator*=(T rhs);
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    big_integer& operator/=(T rhs);
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    big_integer& operator%=(T rhs);
+
     big_integer operator+() const;
-    big_integer operator-() const;
-    big_integer operator~() const;
+    big_integer operator-() const&;
+    big_integer operator-() &&;
+    big_integer operator~() const&;
+    big_integer operator~() &&;
 
     big_integer& operator++();
     big_integer operator++(int);
@@ -38,6 +103,20 @@ struct big_integer
     big_integer& operator--();
     big_integer operator--(int);
 
+    friend product_expression operator*(big_integer const& a, big_integer const& b);
+    friend void mul(big_integer& r, big_integer const& a, big_integer const& b);
+    friend big_integer operator+(product_expression const& a, big_integer const& b);
+    friend big_integer operator+(product_expression const& a, product_expression const& b);
+    friend big_integer operator-(product_expression const& a, big_integer const& b);
+    friend big_integer operator-(product_expression const& a, product_expression const& b);
+    friend void divmod(big_integer const& a, big_integer const& b, big_integer* quotient, big_integer* remainder);
+    friend big_integer gcd(big_integer const& a, big_integer const& b);
+    friend big_integer gcdext(big_integer const& a, big_integer const& b, big_integer* s, big_integer* t);
+    friend big_integer isqrt(big_integer const& a);
+    friend big_integer iroot(big_integer const& a, unsigned k);
+    friend bool is_perfect_square(big_integer const& a);
+    friend big_integer product(std::vector<big_integer> factors);
+
     friend bool operator==(big_integer const& a, big_integer const& b);
     friend bool operator!=(big_integer const& a, big_integer const& b);
     friend bool operator<(big_integer const& a, big_integer const& b);
@@ -45,25 +124,348 @@ struct big_integer
     friend bool operator<=(big_integer const& a, big_integer const& b);
     friend bool operator>=(big_integer const& a, big_integer const& b);
 
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator==(big_integer const& a, T b)
+    {
+        return compare(a, is_negative(b), magnitude(b)) == 0;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator!=(big_integer const& a, T b)
+    {
+        return compare(a, is_negative(b), magnitude(b)) != 0;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator<(big_integer const& a, T b)
+    {
+        return compare(a, is_negative(b), magnitude(b)) < 0;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator>(big_integer const& a, T b)
+    {
+        return compare(a, is_negative(b), magnitude(b)) > 0;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator<=(big_integer const& a, T b)
+    {
+        return compare(a, is_negative(b), magnitude(b)) <= 0;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator>=(big_integer const& a, T b)
+    {
+        return compare(a, is_negative(b), magnitude(b)) >= 0;
+    }
+
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator==(T a, big_integer const& b)
+    {
+        return b == a;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator!=(T a, big_integer const& b)
+    {
+        return b != a;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator<(T a, big_integer const& b)
+    {
+        return b > a;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator>(T a, big_integer const& b)
+    {
+        return b < a;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator<=(T a, big_integer const& b)
+    {
+        return b >= a;
+    }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    friend bool operator>=(T a, big_integer const& b)
+    {
+        return b <= a;
+    }
+
     friend std::string to_string(big_integer const& a);
 
 private:
-    mpz_t mpz;
+    template<size_t Bits, bool Signed>
+    friend struct fixed_big_integer;
+    friend struct montgomery_context;
+
+    using storage_t = limb_storage;
+    using limb_t = storage_t::limb_t;
+
+    void trim();
+    void add_magnitude(limb_t const* rhs, size_t rhs_size);
+    void sub_magnitude(limb_t const* rhs, size_t rhs_size);
+    int compare_magnitude(big_integer const& rhs) const;
+    void multiply(big_integer const& a, big_integer const& b);
+    void add_product(product_expression const& product, bool subtract);
+    void add_product(limb_t const* a, size_t an, limb_t const* b, size_t bn, bool product_negative);
+    void add_scalar_product(big_integer const& a, bool b_negative, limb_t b, bool subtract);
+    template<typename Op>
+    void apply_bitwise(big_integer const& rhs, Op op);
+    static int compare(big_integer const& a, big_integer const& b);
+    static big_integer sqrt_remainder(big_integer const& a, size_t bits, big_integer& remainder);
+
+    // a scalar operand is passed on as its sign and magnitude
+    template<typename T>
+    static bool is_negative(T value);
+    template<typename T>
+    static limb_t magnitude(T value);
+    void add_scalar(bool rhs_negative, limb_t rhs);
+    void mul_scalar(bool rhs_negative, limb_t rhs);
+    void div_scalar(bool rhs_negative, limb_t rhs, bool remainder);
+    static int compare(big_integer const& a, bool b_negative, limb_t b);
+
+    bool negative;
+    storage_t limbs;
 };
 
 big_integer operator+(big_integer a, big_integer const& b);
 big_integer operator-(big_integer a, big_integer const& b);
-big_integer operator*(big_integer a, big_integer const& b);
+big_integer::product_expression operator*(big_integer const& a, big_integer const& b);
+big_integer operator*(big_integer&& a, big_integer const& b);
+big_integer operator*(big_integer const& a, big_integer&& b);
+big_integer operator*(big_integer&& a, big_integer&& b);
 big_integer operator/(big_integer a, big_integer const& b);
 big_integer operator%(big_integer a, big_integer const& b);
 
+// r = a * b, written straight into the storage of r unless r is a or b
+void mul(big_integer& r, big_integer const& a, big_integer const& b);
+
+// quotient and remainder of the truncating division a / b from a single pass;
+// the outputs of the second form may be null or alias a or b, but not each other
+std::pair<big_integer, big_integer> divmod(big_integer const& a, big_integer const& b);
+void divmod(big_integer const& a, big_integer const& b, big_integer* quotient, big_integer* remainder);
+
+// gcd(a, b) >= 0 and lcm(a, b) >= 0; gcd(a, b) is 0 only if a and b both are,
+// and lcm(a, b) is 0 if either of them is
+big_integer gcd(big_integer const& a, big_integer const& b);
+big_integer lcm(big_integer const& a, big_integer const& b);
+
+// g = gcd(a, b) = a s + b t with the s and t of mpz_gcdext, |s| < |b| / (2 g)
+// and |t| < |a| / (2 g) save for the cases where no such pair exists; s and t
+// may be null
+big_integer gcdext(big_integer const& a, big_integer const& b, big_integer* s, big_integer* t);
+
+// the inverse of a modulo modulus in [0, modulus); throws std::runtime_error
+// if modulus <= 0 or gcd(a, modulus) != 1
+big_integer modinv(big_integer const& a, big_integer const& modulus);
+
+// floor(a^(1/k)), rounded towards zero for negative a and odd k; throws
+// std::runtime_error if k == 0 or a < 0 and k is even
+big_integer isqrt(big_integer const& a);
+big_integer iroot(big_integer const& a, unsigned k);
+bool is_perfect_square(big_integer const& a);
+
+// the product of the factors, 1 if there are none, computed by a balanced
+// tree of products rather than by multiplying them into one accumulator in
+// turn; the products of a level run in parallel once they reach
+// kernels::parallel_threshold limbs between them
+big_integer product(std::vector<big_integer> factors);
+template<typename InputIt>
+big_integer product(InputIt first, InputIt last)
+{
+    return product(std::vector<big_integer>(first, last));
+}
+
 big_integer operator&(big_integer a, big_integer const& b);
 big_integer operator|(big_integer a, big_integer const& b);
 big_integer operator^(big_integer a, big_integer const& b);
 
+// reuse the storage of a temporary right operand
+big_integer operator+(big_integer const& a, big_integer&& b);
+big_integer operator-(big_integer const& a, big_integer&& b);
+big_integer operator&(big_integer const& a, big_integer&& b);
+big_integer operator|(big_integer const& a, big_integer&& b);
+big_integer operator^(big_integer const& a, big_integer&& b);
+
+// sums with a product allocate their result once, sized for the whole sum,
+// or accumulate the product into the storage of a temporary operand
+big_integer operator+(big_integer::product_expression const& a, big_integer const& b);
+big_integer operator+(big_integer::product_expression const& a, big_integer&& b);
+big_integer operator+(big_integer const& a, big_integer::product_expression const& b);
+big_integer operator+(big_integer&& a, big_integer::product_expression const& b);
+big_integer operator+(big_integer::product_expression const& a, big_integer::product_expression const& b);
+big_integer operator-(big_integer::product_expression const& a, big_integer const& b);
+big_integer operator-(big_integer::product_expression const& a, big_integer&& b);
+big_integer operator-(big_integer const& a, big_integer::product_expression const& b);
+big_integer operator-(big_integer&& a, big_integer::product_expression const& b);
+big_integer operator-(big_integer::product_expression const& a, big_integer::product_expression const& b);
+
 big_integer operator<<(big_integer a, int b);
 big_integer operator>>(big_integer a, int b);
 
+template<typename T>
+bool big_integer::is_negative(T value)
+{
+    return std::is_signed<T>::value && value < T(0);
+}
+
+template<typename T>
+big_integer::limb_t big_integer::magnitude(T value)
+{
+    static_assert(sizeof(T) <= sizeof(limb_t), "scalar operands must fit in a limb");
+    limb_t bits = static_cast<limb_t>(value);
+    return is_negative(value) ? 0 - bits : bits;
+}
+
+template<typename T, typename>
+big_integer& big_integer::operator+=(T rhs)
+{
+    add_scalar(is_negative(rhs), magnitude(rhs));
+    return *this;
+}
+
+template<typename T, typename>
+big_integer& big_integer::operator-=(T rhs)
+{
+    add_scalar(!is_negative(rhs), magnitude(rhs));
+    return *this;
+}
+
+template<typename T, typename>
+big_integer& big_integer::operator*=(T rhs)
+{
+    mul_scalar(is_negative(rhs), magnitude(rhs));
+    return *this;
+}
+
+template<typename T, typename>
+big_integer& big_integer::operator/=(T rhs)
+{
+    div_scalar(is_negative(rhs), magnitude(rhs), false);
+    return *this;
+}
+
+template<typename T, typename>
+big_integer& big_integer::operator%=(T rhs)
+{
+    div_scalar(is_negative(rhs), magnitude(rhs), true);
+    return *this;
+}
+
+template<typename T, typename>
+big_integer& big_integer::addmul(big_integer const& a, T b)
+{
+    add_scalar_product(a, is_negative(b), magnitude(b), false);
+    return *this;
+}
+
+template<typename T, typename>
+big_integer& big_integer::submul(big_integer const& a, T b)
+{
+    add_scalar_product(a, is_negative(b), magnitude(b), true);
+    return *this;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator+(big_integer a, T b)
+{
+    a += b;
+    return a;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator+(T a, big_integer b)
+{
+    b += a;
+    return b;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator-(big_integer a, T b)
+{
+    a -= b;
+    return a;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator-(T a, big_integer b)
+{
+    b -= a;
+    return -std::move(b);
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator+(big_integer::product_expression const& a, T b)
+{
+    big_integer r = a;
+    r += b;
+    return r;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator+(T a, big_integer::product_expression const& b)
+{
+    return b + a;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator-(big_integer::product_expression const& a, T b)
+{
+    big_integer r = a;
+    r -= b;
+    return r;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator-(T a, big_integer::product_expression const& b)
+{
+    big_integer r = -b;
+    r += a;
+    return r;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator*(big_integer a, T b)
+{
+    a *= b;
+    return a;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator*(T a, big_integer b)
+{
+    b *= a;
+    return b;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator/(big_integer a, T b)
+{
+    a /= b;
+    return a;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator%(big_integer a, T b)
+{
+    a %= b;
+    return a;
+}
+
+// a scalar dividend is widened to a big_integer without going through int
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator/(T a, big_integer const& b)
+{
+    big_integer r;
+    r += a;
+    r /= b;
+    return r;
+}
+
+template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+big_integer operator%(T a, big_integer const& b)
+{
+    big_integer r;
+    r += a;
+    r %= b;
+    return r;
+}
+
 bool operator==(big_integer const& a, big_integer const& b);
 bool operator!=(big_integer const& a, big_integer const& b);
 bool operator<(big_integer const& a, big_integer const& b);
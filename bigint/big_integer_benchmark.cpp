@@ -0,0 +1,1004 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "big_integer.h"
+#include "big_integer_fixed.h"
+#include "big_integer_gmp.h"
+#include "big_integer_kernels.h"
+#include "big_integer_montgomery.h"
+
+// Usage: [BIG_INTEGER_KERNELS=portable|x86_adx|x86_ifma] big_integer_benchmark [name-filter]
+// Prints nanoseconds per operation; build with -DCMAKE_BUILD_TYPE=Release.
+
+#ifndef BIG_INTEGER_LIMB_POOL
+#define BIG_INTEGER_LIMB_POOL 0
+#endif
+
+#ifndef BIG_INTEGER_SHARED_STORAGE
+#define BIG_INTEGER_SHARED_STORAGE 0
+#endif
+
+namespace {
+size_t allocations = 0;
+}
+
+void* operator new(size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+namespace {
+template<typename T>
+void keep(T const& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+template<typename F>
+double measure(size_t iterations, F&& f) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i != iterations; ++i)
+    f(i);
+  auto finish = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(finish - start).count() / iterations;
+}
+
+void report(std::string const& name, double ours, double gmp) {
+  std::printf("%-44s %12.1f ns %12.1f ns   gmp/ours %6.2f\n", name.c_str(), ours, gmp, gmp / ours);
+}
+
+std::vector<std::string> random_numbers(size_t count, size_t bits, unsigned seed) {
+  std::default_random_engine rng(seed);
+  std::vector<std::string> result;
+  for (size_t i = 0; i != count; ++i) {
+    big_integer_gmp x;
+    x.random(bits, rng);
+    if (x == 0)
+      x = 1;
+    result.push_back(to_string(x));
+  }
+  return result;
+}
+
+template<typename T>
+std::vector<T> parse(std::vector<std::string> const& numbers) {
+  std::vector<T> result;
+  for (std::string const& s : numbers)
+    result.push_back(T(s));
+  return result;
+}
+
+struct add_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const { return a + b; }
+};
+
+struct sub_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const { return a - b; }
+};
+
+struct mul_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const { return a * b; }
+};
+
+struct div_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const { return a / b; }
+};
+
+struct mod_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const { return a % b; }
+};
+
+struct div_and_mod_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const {
+    T q = a / b;
+    keep(q);
+    return a % b;
+  }
+};
+
+struct divmod_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const {
+    std::pair<T, T> qr = divmod(a, b);
+    keep(qr.first);
+    return qr.second;
+  }
+};
+
+template<typename T, typename Op>
+double binary_op(std::vector<std::string> const& lhs, std::vector<std::string> const& rhs, size_t iterations, Op op) {
+  std::vector<T> a = parse<T>(lhs);
+  std::vector<T> b = parse<T>(rhs);
+  return measure(iterations, [&](size_t i) {
+    T r = op(a[i % a.size()], b[i % b.size()]);
+    keep(r);
+  });
+}
+
+struct gcd_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const { return gcd(a, b); }
+};
+
+struct gcdext_op {
+  template<typename T>
+  T operator()(T const& a, T const& b) const {
+    T s;
+    T g = gcdext(a, b, &s, static_cast<T*>(nullptr));
+    keep(s);
+    return g;
+  }
+};
+
+template<typename Op>
+void compare_binary_op(std::string const& name, size_t lhs_bits, size_t rhs_bits, size_t iterations, Op op) {
+  size_t count = std::min<size_t>(iterations, 1024);
+  std::vector<std::string> lhs = random_numbers(count, lhs_bits, 1);
+  std::vector<std::string> rhs = random_numbers(count, rhs_bits, 2);
+  double ours = binary_op<big_integer>(lhs, rhs, iterations, op);
+  double gmp = binary_op<big_integer_gmp>(lhs, rhs, iterations, op);
+  report(name + " " + std::to_string(lhs_bits) + "x" + std::to_string(rhs_bits) + " bits", ours, gmp);
+}
+
+void small_operands() {
+  size_t const iterations = 1000000;
+  for (size_t bits = 64; bits <= 256; bits += 64) {
+    compare_binary_op("add", bits, bits, iterations, add_op());
+    compare_binary_op("sub", bits, bits, iterations, sub_op());
+    compare_binary_op("mul", bits, bits, iterations, mul_op());
+    compare_binary_op("div", bits, bits / 2, iterations, div_op());
+    compare_binary_op("mod", bits, bits / 2, iterations, mod_op());
+  }
+}
+
+template<typename T>
+double small_values_loop(std::vector<int> const& values, size_t iterations) {
+  return measure(iterations, [&](size_t i) {
+    T a = values[i % values.size()];
+    T b = values[(i + 1) % values.size()];
+    T c = a + b;
+    c *= a;
+    c -= b;
+    keep(c);
+  });
+}
+
+void small_values() {
+  size_t const iterations = 10000000;
+  std::vector<int> values;
+  std::mt19937 rng(1);
+  for (size_t i = 0; i != 4096; ++i)
+    values.push_back(static_cast<int>(rng()));
+
+  size_t before = allocations;
+  double ours = small_values_loop<big_integer>(values, iterations);
+  double per_iteration = static_cast<double>(allocations - before) / iterations;
+  double gmp = small_values_loop<big_integer_gmp>(values, iterations);
+  report("construct, add, mul, sub, destroy", ours, gmp);
+  std::printf("%-44s %12.3f\n", "heap allocations per iteration", per_iteration);
+}
+
+template<typename T>
+double expression_chain_loop(std::vector<std::string> const& numbers, size_t iterations) {
+  std::vector<T> x = parse<T>(numbers);
+  return measure(iterations, [&](size_t i) {
+    T const& a = x[i % x.size()];
+    T const& b = x[(i + 1) % x.size()];
+    T const& c = x[(i + 2) % x.size()];
+    T r = a * b + c;
+    keep(r);
+  });
+}
+
+template<typename T>
+double expression_chain_loop2(std::vector<std::string> const& numbers, size_t iterations) {
+  std::vector<T> x = parse<T>(numbers);
+  return measure(iterations, [&](size_t i) {
+    T const& a = x[i % x.size()];
+    T const& b = x[(i + 1) % x.size()];
+    T const& c = x[(i + 2) % x.size()];
+    T const& d = x[(i + 3) % x.size()];
+    T const& e = x[(i + 4) % x.size()];
+    T r = a * b + c * d - e;
+    keep(r);
+  });
+}
+
+void expression_chain() {
+  size_t const iterations = 200000;
+  for (size_t bits = 256; bits <= 16384; bits *= 4) {
+    std::vector<std::string> numbers = random_numbers(64, bits, 3);
+    size_t before = allocations;
+    double ours = expression_chain_loop<big_integer>(numbers, iterations);
+    double per_iteration = static_cast<double>(allocations - before) / iterations;
+    double gmp = expression_chain_loop<big_integer_gmp>(numbers, iterations);
+    report("a * b + c, " + std::to_string(bits) + " bits", ours, gmp);
+    std::printf("%-44s %12.3f\n", "  heap allocations per iteration", per_iteration);
+
+    before = allocations;
+    ours = expression_chain_loop2<big_integer>(numbers, iterations);
+    per_iteration = static_cast<double>(allocations - before) / iterations;
+    gmp = expression_chain_loop2<big_integer_gmp>(numbers, iterations);
+    report("a * b + c * d - e, " + std::to_string(bits) + " bits", ours, gmp);
+    std::printf("%-44s %12.3f\n", "  heap allocations per iteration", per_iteration);
+  }
+}
+
+// Scalar is the type the int operands are passed as: int itself or T
+template<typename T, typename Scalar>
+double scalar_operands_loop(std::string const& number, std::vector<int> const& values, size_t iterations) {
+  T x(number);
+  return measure(iterations, [&](size_t i) {
+    Scalar v = Scalar(values[i % values.size()]);
+    x *= v;
+    x += v;
+    x /= v;
+    if (x < v)
+      x -= v;
+    keep(x);
+  });
+}
+
+void scalar_operands() {
+  size_t const iterations = 1000000;
+  std::vector<int> values;
+  std::mt19937 rng(1);
+  for (size_t i = 0; i != 4096; ++i)
+    values.push_back(static_cast<int>(rng() | 1));
+
+  for (size_t bits = 64; bits <= 4096; bits *= 4) {
+    std::string number = random_numbers(1, bits, 4)[0];
+    std::string suffix = ", " + std::to_string(bits) + " bits";
+    double scalar = scalar_operands_loop<big_integer, int>(number, values, iterations);
+    double converted = scalar_operands_loop<big_integer, big_integer>(number, values, iterations);
+    double gmp = scalar_operands_loop<big_integer_gmp, big_integer_gmp>(number, values, iterations);
+    report("mul, add, div, cmp by int" + suffix, scalar, gmp);
+    report("  same through big_integer(int)" + suffix, converted, gmp);
+  }
+}
+
+// x = (x * y + z) % m over operands of half the width, as in modular arithmetic
+template<typename T>
+double mul_mod_loop(std::vector<std::string> const& numbers, std::string const& modulus, size_t iterations) {
+  std::vector<T> x = parse<T>(numbers);
+  T m(modulus);
+  T acc = x[0];
+  return measure(iterations, [&](size_t i) {
+    acc = (acc * x[i % x.size()] + x[(i + 1) % x.size()]) % m;
+    keep(acc);
+  });
+}
+
+template<size_t Bits>
+void fixed_width_bits() {
+  size_t const iterations = 1000000;
+  std::vector<std::string> numbers = random_numbers(64, Bits / 2 - 2, 5);
+  for (std::string& s : numbers)
+    if (s[0] == '-')
+      s.erase(0, 1);
+  std::string modulus = random_numbers(1, Bits / 2 - 1, 6)[0];
+  if (modulus[0] == '-')
+    modulus.erase(0, 1);
+  double fixed = mul_mod_loop<fixed_big_integer<Bits>>(numbers, modulus, iterations);
+  double dynamic = mul_mod_loop<big_integer>(numbers, modulus, iterations);
+  double gmp = mul_mod_loop<big_integer_gmp>(numbers, modulus, iterations);
+  report("fixed_big_integer<" + std::to_string(Bits) + "> (x * y + z) % m", fixed, gmp);
+  report("  big_integer", dynamic, gmp);
+}
+
+void fixed_width() {
+  fixed_width_bits<256>();
+  fixed_width_bits<512>();
+}
+
+template<typename T>
+double mul_then_mod_loop(std::vector<std::string> const& numbers, std::string const& modulus, size_t iterations) {
+  std::vector<T> x = parse<T>(numbers);
+  T m(modulus);
+  T acc = x[0];
+  return measure(iterations, [&](size_t i) {
+    acc = acc * x[i % x.size()] % m;
+    keep(acc);
+  });
+}
+
+double montgomery_loop(std::vector<std::string> const& numbers, std::string const& modulus, size_t iterations) {
+  montgomery_context ctx{big_integer(modulus)};
+  std::vector<big_integer> x;
+  for (std::string const& s : numbers)
+    x.push_back(ctx.to_montgomery(big_integer(s)));
+  big_integer acc = x[0];
+  return measure(iterations, [&](size_t i) {
+    acc = ctx.mulmod(acc, x[i % x.size()]);
+    keep(acc);
+  });
+}
+
+void montgomery() {
+  for (size_t bits = 256; bits <= 16384; bits *= 4) {
+    size_t iterations = 400000000 / (bits * bits / 64 + 4000);
+    std::vector<std::string> numbers = random_numbers(64, bits - 2, 7);
+    std::string modulus = random_numbers(1, bits - 1, 8)[0];
+    if (modulus[0] == '-')
+      modulus.erase(0, 1);
+    if ((modulus.back() - '0') % 2 == 0)
+      ++modulus.back();
+    double ours = montgomery_loop(numbers, modulus, iterations);
+    double divided = mul_then_mod_loop<big_integer>(numbers, modulus, iterations);
+    double gmp = mul_then_mod_loop<big_integer_gmp>(numbers, modulus, iterations);
+    std::string suffix = ", " + std::to_string(bits) + " bits";
+    report("montgomery_context::mulmod" + suffix, ours, gmp);
+    report("  (a * b) % m" + suffix, divided, gmp);
+  }
+}
+
+template<typename T, typename Pow>
+double powmod_loop(std::vector<std::string> const& numbers, std::string const& modulus, size_t iterations, Pow pow) {
+  std::vector<T> x = parse<T>(numbers);
+  T m(modulus);
+  return measure(iterations, [&](size_t i) {
+    T r = pow(x[i % x.size()], x[(i + 1) % x.size()], m);
+    keep(r);
+  });
+}
+
+struct powmod_op {
+  template<typename T>
+  T operator()(T const& base, T const& exponent, T const& modulus) const { return powmod(base, exponent, modulus); }
+};
+
+struct powmod_ct_op {
+  template<typename T>
+  T operator()(T const& base, T const& exponent, T const& modulus) const { return powmod_ct(base, exponent, modulus); }
+};
+
+void exponentiation() {
+  for (size_t bits = 2048; bits <= 4096; bits *= 2) {
+    size_t iterations = 8 * 4096 / bits;
+    std::vector<std::string> numbers = random_numbers(8, bits - 2, 9);
+    for (std::string& s : numbers)
+      if (s[0] == '-')
+        s.erase(0, 1);
+    std::string modulus = random_numbers(1, bits - 1, 10)[0];
+    if (modulus[0] == '-')
+      modulus.erase(0, 1);
+    if ((modulus.back() - '0') % 2 == 0)
+      ++modulus.back();
+    std::string suffix = ", " + std::to_string(bits) + " bits";
+    report("powmod" + suffix, powmod_loop<big_integer>(numbers, modulus, iterations, powmod_op()),
+           powmod_loop<big_integer_gmp>(numbers, modulus, iterations, powmod_op()));
+    report("powmod_ct" + suffix, powmod_loop<big_integer>(numbers, modulus, iterations, powmod_ct_op()),
+           powmod_loop<big_integer_gmp>(numbers, modulus, iterations, powmod_ct_op()));
+  }
+}
+
+// the limb loops on their own in every implementation the processor supports,
+// next to GMP's
+void basecase_kernels() {
+  std::mt19937_64 rng(1);
+  auto row = [](std::string const& name, std::vector<double> const& times) {
+    std::printf("%-44s", name.c_str());
+    for (double t : times)
+      std::printf(" %12.1f ns", t);
+    std::printf("\n");
+  };
+  std::printf("%-44s", "");
+  for (size_t k = 0; k != kernels::implementation_count; ++k)
+    if (kernels::implementations[k].supported())
+      std::printf(" %15s", kernels::implementations[k].name);
+  std::printf(" %15s\n", "gmp");
+
+  for (size_t n = 4; n <= 32; n += 4) {
+    std::vector<kernels::limb_t> a(n), b(n), r(2 * n);
+    for (size_t i = 0; i != n; ++i) {
+      a[i] = rng();
+      b[i] = rng();
+    }
+    size_t iterations = 200000000 / (n * n + 16);
+    std::vector<double> times;
+    for (size_t k = 0; k != kernels::implementation_count; ++k) {
+      kernels::implementation const& impl = kernels::implementations[k];
+      if (impl.supported())
+        times.push_back(measure(iterations, [&](size_t) {
+          impl.mul_basecase(r.data(), a.data(), n, b.data(), n);
+          keep(r);
+        }));
+    }
+    times.push_back(measure(iterations, [&](size_t) {
+      mpn_mul(r.data(), a.data(), static_cast<mp_size_t>(n), b.data(), static_cast<mp_size_t>(n));
+      keep(r);
+    }));
+    row("mul_basecase " + std::to_string(n) + "x" + std::to_string(n) + " limbs", times);
+  }
+
+  for (size_t n = 16; n <= 1024; n *= 4) {
+    std::vector<kernels::limb_t> a(n), b(n), r(n);
+    for (size_t i = 0; i != n; ++i) {
+      a[i] = rng();
+      b[i] = rng();
+    }
+    size_t iterations = 100000000 / (n + 16);
+    std::vector<double> add_times, addmul_times;
+    for (size_t k = 0; k != kernels::implementation_count; ++k) {
+      kernels::implementation const& impl = kernels::implementations[k];
+      if (!impl.supported())
+        continue;
+      add_times.push_back(measure(iterations, [&](size_t) { keep(impl.add_n(r.data(), a.data(), b.data(), n)); }));
+      addmul_times.push_back(measure(iterations, [&](size_t) { keep(impl.addmul_1(r.data(), a.data(), n, b[0])); }));
+    }
+    add_times.push_back(measure(iterations, [&](size_t) {
+      keep(mpn_add_n(r.data(), a.data(), b.data(), static_cast<mp_size_t>(n)));
+    }));
+    addmul_times.push_back(measure(iterations, [&](size_t) {
+      keep(mpn_addmul_1(r.data(), a.data(), static_cast<mp_size_t>(n), b[0]));
+    }));
+    row("add_n " + std::to_string(n) + " limbs", add_times);
+    row("addmul_1 " + std::to_string(n) + " limbs", addmul_times);
+  }
+}
+
+void mul() {
+  for (size_t bits = 1024; bits <= 4194304; bits *= 4) {
+    size_t iterations = std::max<size_t>(4, (size_t(1) << 34) / bits / bits);
+    compare_binary_op("mul", bits, bits, iterations, mul_op());
+  }
+}
+
+template<typename Op>
+double op_time(big_integer const& a, big_integer const& b, size_t limbs, Op op) {
+  size_t iterations = std::max<size_t>(4, 20000000 / limbs / limbs);
+  return measure(iterations, [&](size_t) {
+    big_integer r = op(a, b);
+    keep(r);
+  });
+}
+
+// finds the smallest size from which calling the next algorithm at the top
+// level and the current one below it beats the current algorithm alone;
+// the operands have ratio * n and n limbs
+template<typename Op>
+size_t crossover(size_t& threshold, size_t first, size_t last, size_t step, size_t ratio, Op op) {
+  size_t found = 0;
+  for (size_t n = first; n <= last; n += step) {
+    std::vector<std::string> a = random_numbers(1, ratio * n * 64 - 1, static_cast<unsigned>(n));
+    std::vector<std::string> b = random_numbers(1, n * 64 - 1, static_cast<unsigned>(n + 1));
+    big_integer x(a[0]);
+    big_integer y(b[0]);
+    threshold = n + 1;
+    double before = op_time(x, y, n, op);
+    threshold = n;
+    double after = op_time(x, y, n, op);
+    std::printf("  %4zu limbs %12.1f ns %12.1f ns\n", n, before, after);
+    if (after < before && found == 0)
+      found = n;
+    else if (after >= before)
+      found = 0;
+  }
+  return found != 0 ? found : last;
+}
+
+void mul_thresholds() {
+  size_t const karatsuba = kernels::karatsuba_threshold;
+  size_t const toom3 = kernels::toom3_threshold;
+  size_t const fft = kernels::fft_threshold;
+  size_t const radix52 = kernels::ifma_threshold;
+
+  // the scalar algorithms; radix52_mul calibrates the radix 2^52 product
+  kernels::ifma_threshold = SIZE_MAX;
+  std::printf("basecase vs Karatsuba\n");
+  kernels::toom3_threshold = SIZE_MAX;
+  kernels::fft_threshold = SIZE_MAX;
+  size_t karatsuba_found = crossover(kernels::karatsuba_threshold, 8, 96, 4, 1, mul_op());
+  std::printf("Karatsuba vs Toom-3\n");
+  kernels::karatsuba_threshold = karatsuba_found;
+  size_t toom3_found = crossover(kernels::toom3_threshold, 64, 512, 32, 1, mul_op());
+
+  std::printf("Toom-3 vs NTT\n");
+  kernels::toom3_threshold = toom3_found;
+  size_t fft_found = crossover(kernels::fft_threshold, 512, 8192, 512, 1, mul_op());
+
+  std::printf("suggested: -DBIG_INTEGER_KARATSUBA_THRESHOLD=%zu -DBIG_INTEGER_TOOM3_THRESHOLD=%zu"
+              " -DBIG_INTEGER_FFT_THRESHOLD=%zu\n", karatsuba_found, toom3_found, fft_found);
+  kernels::karatsuba_threshold = karatsuba;
+  kernels::toom3_threshold = toom3;
+  kernels::fft_threshold = fft;
+  kernels::ifma_threshold = radix52;
+}
+
+// operator* through the scalar kernels and through the radix 2^52 product,
+// then the sizes between which the latter pays off
+void radix52_mul() {
+  std::string const active = kernels::active_implementation().name;
+  kernels::implementation const* scalar = nullptr;
+  kernels::implementation const* radix52 = nullptr;
+  for (size_t k = 0; k != kernels::implementation_count; ++k) {
+    kernels::implementation const& impl = kernels::implementations[k];
+    if (impl.supported())
+      (impl.mul_radix52 != nullptr ? radix52 : scalar) = &impl;
+  }
+  if (radix52 == nullptr) {
+    std::printf("no radix 2^52 kernels on this processor\n");
+    return;
+  }
+  std::printf("%-44s %15s %15s %15s\n", "", scalar->name, radix52->name, "gmp");
+  for (size_t bits = 256; bits <= 16384; bits *= 2) {
+    size_t iterations = std::max<size_t>(1000, (size_t(1) << 31) / bits / bits * 64);
+    size_t count = std::min<size_t>(iterations, 1024);
+    std::vector<std::string> lhs = random_numbers(count, bits, 1);
+    std::vector<std::string> rhs = random_numbers(count, bits, 2);
+    kernels::select_implementation(scalar->name);
+    double scalar_time = binary_op<big_integer>(lhs, rhs, iterations, mul_op());
+    kernels::select_implementation(radix52->name);
+    double radix52_time = binary_op<big_integer>(lhs, rhs, iterations, mul_op());
+    double gmp_time = binary_op<big_integer_gmp>(lhs, rhs, iterations, mul_op());
+    std::printf("%-44s %12.1f ns %12.1f ns %12.1f ns\n", ("mul " + std::to_string(bits) + " bits").c_str(),
+                scalar_time, radix52_time, gmp_time);
+  }
+
+  size_t const low = kernels::ifma_threshold;
+  size_t const high = kernels::ifma_karatsuba_threshold;
+  std::printf("scalar basecase vs radix 2^52\n");
+  kernels::ifma_karatsuba_threshold = SIZE_MAX;
+  size_t low_found = crossover(kernels::ifma_threshold, 2, 32, 2, 1, mul_op());
+  std::printf("radix 2^52 vs Karatsuba\n");
+  kernels::ifma_threshold = low_found;
+  size_t const toom3 = kernels::toom3_threshold;
+  kernels::toom3_threshold = SIZE_MAX;
+  size_t high_found = crossover(kernels::ifma_karatsuba_threshold, 32, 512, 32, 1, mul_op());
+  std::printf("suggested: -DBIG_INTEGER_IFMA_THRESHOLD=%zu -DBIG_INTEGER_IFMA_KARATSUBA_THRESHOLD=%zu\n", low_found,
+              high_found);
+  kernels::ifma_threshold = low;
+  kernels::ifma_karatsuba_threshold = high;
+  kernels::toom3_threshold = toom3;
+  kernels::select_implementation(active.c_str());
+}
+
+// operator* on one thread and on all of them, for products that fork
+void parallel_mul() {
+  size_t const threads = kernels::thread_count();
+  std::printf("%-44s %15s %12s%3zu %15s\n", "", "1 thread", "threads:", threads, "gmp");
+  for (size_t bits = 1 << 20; bits <= (1 << 26); bits *= 4) {
+    size_t iterations = std::max<size_t>(2, (size_t(1) << 27) / bits);
+    std::vector<std::string> lhs = random_numbers(2, bits, 1);
+    std::vector<std::string> rhs = random_numbers(2, bits, 2);
+    kernels::set_thread_count(1);
+    double serial = binary_op<big_integer>(lhs, rhs, iterations, mul_op());
+    kernels::set_thread_count(threads);
+    double parallel = binary_op<big_integer>(lhs, rhs, iterations, mul_op());
+    double gmp = binary_op<big_integer_gmp>(lhs, rhs, iterations, mul_op());
+    std::printf("%-44s %12.0f ns %12.0f ns %12.0f ns\n", ("mul " + std::to_string(bits) + " bits").c_str(), serial,
+                parallel, gmp);
+  }
+}
+
+// n! and products of random 4096-bit factors, multiplied into an accumulator
+// one factor at a time and by a product tree
+template<typename T>
+void product_tree_row(std::string const& name, std::vector<std::string> const& numbers) {
+  std::vector<T> factors = parse<T>(numbers);
+  size_t iterations = std::max<size_t>(1, 2000000 / numbers.size() / numbers.size());
+  double sequential = measure(iterations, [&](size_t) {
+    T accumulator = 1;
+    for (T const& x : factors)
+      accumulator *= x;
+    keep(accumulator);
+  });
+  double tree = measure(iterations, [&](size_t) {
+    T r = product(factors);
+    keep(r);
+  });
+  std::printf("%-44s %12.0f ns %12.0f ns\n", name.c_str(), sequential, tree);
+}
+
+void product_tree() {
+  std::printf("%-44s %15s %15s\n", "", "accumulator", "product");
+  for (size_t n = 100; n <= 100000; n *= 10) {
+    std::vector<std::string> numbers;
+    for (size_t i = 1; i <= n; ++i)
+      numbers.push_back(std::to_string(i));
+    product_tree_row<big_integer>(std::to_string(n) + "!", numbers);
+    product_tree_row<big_integer_gmp>(std::to_string(n) + "! gmp", numbers);
+  }
+  for (size_t n = 10; n <= 1000; n *= 10) {
+    std::vector<std::string> numbers = random_numbers(n, 4096, 3);
+    product_tree_row<big_integer>(std::to_string(n) + " x 4096 bits", numbers);
+    product_tree_row<big_integer_gmp>(std::to_string(n) + " x 4096 bits gmp", numbers);
+  }
+}
+
+// heap allocations of one a * b or a / b, the limbs of the result included
+template<typename Op>
+double allocations_per_op(size_t lhs_bits, size_t rhs_bits, Op op) {
+  std::vector<big_integer> lhs = parse<big_integer>(random_numbers(16, lhs_bits, 1));
+  std::vector<big_integer> rhs = parse<big_integer>(random_numbers(16, rhs_bits, 2));
+  size_t before = allocations;
+  for (size_t i = 0; i != lhs.size(); ++i) {
+    big_integer r = op(lhs[i], rhs[i]);
+    keep(r);
+  }
+  return static_cast<double>(allocations - before) / lhs.size();
+}
+
+void mul_allocations() {
+  for (size_t bits = 1024; bits <= 1048576; bits *= 2) {
+    std::string size = std::to_string(bits) + " bits";
+    std::printf("%-44s %12.3f\n", ("heap allocations per a * b, " + size).c_str(),
+                allocations_per_op(bits, bits, mul_op()));
+    std::printf("%-44s %12.3f\n", ("heap allocations per a / b, 2x" + size).c_str(),
+                allocations_per_op(2 * bits, bits, div_op()));
+  }
+}
+
+// sum of c[i] * x[i], the inner loop of evaluating a polynomial at many
+// points, with the product of each term held in a temporary or accumulated
+// by addmul
+template<typename T>
+double dot_product_loop(std::vector<T> const& c, std::vector<T> const& x, size_t iterations, bool fused) {
+  T accumulator;
+  return measure(iterations, [&](size_t) {
+    accumulator = 0;
+    for (size_t i = 0; i != c.size(); ++i) {
+      if (fused) {
+        accumulator.addmul(c[i], x[i]);
+      } else {
+        T term = c[i] * x[i];
+        accumulator += term;
+      }
+    }
+    keep(accumulator);
+  });
+}
+
+void fused_multiply() {
+  for (size_t bits = 256; bits <= 262144; bits *= 4) {
+    std::vector<std::string> c = random_numbers(64, bits, 1);
+    std::vector<std::string> x = random_numbers(64, bits, 2);
+    std::vector<big_integer> C = parse<big_integer>(c), X = parse<big_integer>(x);
+    std::vector<big_integer_gmp> C_gmp = parse<big_integer_gmp>(c), X_gmp = parse<big_integer_gmp>(x);
+    size_t iterations = std::max<size_t>(2, (size_t(1) << 28) / bits / bits + 16);
+    double gmp = dot_product_loop(C_gmp, X_gmp, iterations, true) / c.size();
+    std::string suffix = ", " + std::to_string(bits) + " bits";
+    report("acc += t, t = a * b" + suffix, dot_product_loop(C, X, iterations, false) / c.size(), gmp);
+    size_t before = allocations;
+    report("acc.addmul(a, b)" + suffix, dot_product_loop(C, X, iterations, true) / c.size(), gmp);
+    std::printf("%-44s %12.3f\n", "  heap allocations per addmul",
+                static_cast<double>(allocations - before) / iterations / c.size());
+  }
+}
+
+void div() {
+  for (size_t bits = 1024; bits <= 2097152; bits *= 4) {
+    size_t iterations = std::max<size_t>(4, (size_t(1) << 34) / bits / bits);
+    compare_binary_op("div", 2 * bits, bits, iterations, div_op());
+    compare_binary_op("div and mod", 2 * bits, bits, iterations, div_and_mod_op());
+    compare_binary_op("divmod", 2 * bits, bits, iterations, divmod_op());
+  }
+}
+
+void div_thresholds() {
+  size_t const dc = kernels::dc_div_threshold;
+  size_t const newton = kernels::newton_div_threshold;
+
+  std::printf("schoolbook vs Burnikel-Ziegler\n");
+  kernels::newton_div_threshold = SIZE_MAX;
+  size_t dc_found = crossover(kernels::dc_div_threshold, 8, 128, 8, 2, div_op());
+  std::printf("Burnikel-Ziegler vs Newton\n");
+  kernels::dc_div_threshold = dc_found;
+  size_t newton_found = crossover(kernels::newton_div_threshold, 8192, 65536, 8192, 2, div_op());
+
+  std::printf("suggested: -DBIG_INTEGER_DC_DIV_THRESHOLD=%zu -DBIG_INTEGER_NEWTON_DIV_THRESHOLD=%zu\n",
+              dc_found, newton_found);
+  kernels::dc_div_threshold = dc;
+  kernels::newton_div_threshold = newton;
+}
+
+void gcd() {
+  for (size_t bits = 128; bits <= 1048576; bits *= 4) {
+    size_t iterations = std::max<size_t>(4, (size_t(1) << 31) / bits / bits * 64 + 16);
+    compare_binary_op("gcd", bits, bits, iterations, gcd_op());
+    compare_binary_op("gcdext", bits, bits, iterations, gcdext_op());
+  }
+}
+
+void gcd_thresholds() {
+  size_t const hgcd = kernels::hgcd_threshold;
+
+  std::printf("Lehmer vs half-gcd\n");
+  size_t hgcd_found = crossover(kernels::hgcd_threshold, 16, 512, 16, 1, gcd_op());
+
+  std::printf("suggested: -DBIG_INTEGER_HGCD_THRESHOLD=%zu\n", hgcd_found);
+  kernels::hgcd_threshold = hgcd;
+}
+
+template<typename T, typename Op>
+double unary_op(std::vector<std::string> const& numbers, size_t iterations, Op op) {
+  std::vector<T> x = parse<T>(numbers);
+  return measure(iterations, [&](size_t i) {
+    auto r = op(x[i % x.size()]);
+    keep(r);
+  });
+}
+
+struct isqrt_op {
+  template<typename T>
+  T operator()(T const& a) const { return isqrt(a); }
+};
+
+struct cbrt_op {
+  template<typename T>
+  T operator()(T const& a) const { return iroot(a, 3); }
+};
+
+struct is_perfect_square_op {
+  template<typename T>
+  bool operator()(T const& a) const { return is_perfect_square(a * a); }
+};
+
+// the square root by bisection on the result bits, for reference
+struct bisection_sqrt_op {
+  big_integer operator()(big_integer const& a) const {
+    big_integer r = 0;
+    for (int bit = static_cast<int>(to_string(a).size() * 10 / 6 + 1); bit >= 0; --bit) {
+      big_integer t = r + (big_integer(1) << bit);
+      if (t * t <= a)
+        r = t;
+    }
+    return r;
+  }
+};
+
+void roots() {
+  for (size_t bits = 1024; bits <= 1048576; bits *= 4) {
+    size_t iterations = std::max<size_t>(4, (size_t(1) << 30) / bits / bits * 64 + 16);
+    std::vector<std::string> numbers = random_numbers(std::min<size_t>(iterations, 64), bits, 11);
+    for (std::string& s : numbers)
+      if (s[0] == '-')
+        s.erase(0, 1);
+    std::string suffix = ", " + std::to_string(bits) + " bits";
+    report("isqrt" + suffix, unary_op<big_integer>(numbers, iterations, isqrt_op()),
+           unary_op<big_integer_gmp>(numbers, iterations, isqrt_op()));
+    if (bits <= 4096)
+      report("  by bisection" + suffix, unary_op<big_integer>(numbers, iterations, bisection_sqrt_op()),
+             unary_op<big_integer_gmp>(numbers, iterations, isqrt_op()));
+    report("iroot(a, 3)" + suffix, unary_op<big_integer>(numbers, iterations, cbrt_op()),
+           unary_op<big_integer_gmp>(numbers, iterations, cbrt_op()));
+    report("is_perfect_square(a * a)" + suffix, unary_op<big_integer>(numbers, iterations, is_perfect_square_op()),
+           unary_op<big_integer_gmp>(numbers, iterations, is_perfect_square_op()));
+  }
+}
+
+// the workload of correctness.mul_div_randomized: multiply an accumulator by
+// a thousand ints, then divide it by all but one of them in another order
+template<typename T>
+double mul_div_loop(std::vector<int> const& multipliers, size_t iterations, limb_arena* arena) {
+  std::vector<int> divisors(multipliers.rbegin(), multipliers.rend());
+  return measure(iterations, [&](size_t) {
+    {
+      T accumulator = 1;
+      for (int m : multipliers)
+        accumulator *= m;
+      for (size_t i = 0; i + 1 != divisors.size(); ++i)
+        accumulator /= divisors[i];
+      keep(accumulator);
+    }
+    if (arena != nullptr)
+      arena->release();
+  });
+}
+
+template<typename T>
+double expression_chain_arena_loop(std::vector<std::string> const& numbers, size_t iterations, limb_arena& arena) {
+  std::vector<T> x = parse<T>(numbers);
+  return measure(iterations, [&](size_t i) {
+    {
+      scoped_limb_allocator scope(arena);
+      T r = x[i % x.size()] * x[(i + 1) % x.size()] + x[(i + 2) % x.size()];
+      keep(r);
+    }
+    arena.release();
+  });
+}
+
+void arena() {
+  size_t const iterations = 2000;
+  std::vector<int> multipliers;
+  std::mt19937 rng(5);
+  for (size_t i = 0; i != 1000; ++i)
+    multipliers.push_back(static_cast<int>(rng() >> 1) | 1);
+  double gmp = mul_div_loop<big_integer_gmp>(multipliers, iterations, nullptr);
+
+  size_t before = allocations;
+  double ours = mul_div_loop<big_integer>(multipliers, iterations, nullptr);
+  report("mul_div_randomized, operator new", ours, gmp);
+  std::printf("%-44s %12.3f\n", "  heap allocations per iteration", static_cast<double>(allocations - before) / iterations);
+
+  limb_arena arena;
+  before = allocations;
+  {
+    scoped_limb_allocator scope(arena);
+    ours = mul_div_loop<big_integer>(multipliers, iterations, &arena);
+  }
+  report("mul_div_randomized, limb_arena", ours, gmp);
+  std::printf("%-44s %12.3f\n", "  heap allocations per iteration", static_cast<double>(allocations - before) / iterations);
+
+  for (size_t bits = 256; bits <= 16384; bits *= 4) {
+    std::vector<std::string> numbers = random_numbers(64, bits, 3);
+    std::string suffix = ", " + std::to_string(bits) + " bits";
+    gmp = expression_chain_loop<big_integer_gmp>(numbers, 200000);
+    report("a * b + c, operator new" + suffix, expression_chain_loop<big_integer>(numbers, 200000), gmp);
+    report("a * b + c, limb_arena" + suffix, expression_chain_arena_loop<big_integer>(numbers, 200000, arena), gmp);
+  }
+}
+
+template<typename T>
+double temporaries_loop(std::vector<std::string> const& numbers, size_t iterations) {
+  std::vector<T> x = parse<T>(numbers);
+  return measure(iterations, [&](size_t i) {
+    T const& a = x[i % x.size()];
+    T const& b = x[(i + 1) % x.size()];
+    T r = a + b;
+    r = r * a - b;
+    T s = r;
+    keep(s);
+  });
+}
+
+// run in builds with and without -DBIG_INTEGER_LIMB_POOL=ON to compare
+void limb_pool() {
+  std::printf("limb pool %s\n", BIG_INTEGER_LIMB_POOL ? "on" : "off");
+  for (size_t bits = 256; bits <= 65536; bits *= 4) {
+    size_t iterations = std::max<size_t>(1000, (size_t(1) << 28) / bits / bits * 256);
+    std::vector<std::string> numbers = random_numbers(64, bits, 6);
+    trim_limb_pool();
+    reset_limb_pool_stats();
+    size_t before = allocations;
+    double ours = temporaries_loop<big_integer>(numbers, iterations);
+    double per_iteration = static_cast<double>(allocations - before) / iterations;
+    limb_pool_statistics statistics = limb_pool_stats();
+    double gmp = temporaries_loop<big_integer_gmp>(numbers, iterations);
+    report("r = (a + b) * a - b, copy, " + std::to_string(bits) + " bits", ours, gmp);
+    std::printf("%-44s %12.3f\n", "  heap allocations per iteration", per_iteration);
+    if (statistics.hits + statistics.misses != 0)
+      std::printf("%-44s %12.4f %12zu bytes peak\n", "  pool hit rate",
+                  static_cast<double>(statistics.hits) / (statistics.hits + statistics.misses), statistics.peak);
+  }
+}
+
+template<typename T>
+double vector_copy_loop(std::vector<T> const& x, size_t iterations) {
+  return measure(iterations, [&](size_t) {
+    std::vector<T> y = x;
+    keep(y);
+  });
+}
+
+// the copies of merge_two: two random elements copied out and a value copied in
+template<typename T>
+double merge_copies_loop(std::vector<T> v, size_t iterations) {
+  std::mt19937 rng(7);
+  return measure(iterations, [&](size_t) {
+    T a = v[rng() % v.size()];
+    T b = v[rng() % v.size()];
+    v[rng() % v.size()] = a < b ? b : a;
+    keep(a);
+    keep(b);
+  });
+}
+
+// operator+(big_integer a, ...) with a copied in and modified
+template<typename T>
+double by_value_sum_loop(std::vector<T> const& x, size_t iterations) {
+  return measure(iterations, [&](size_t i) {
+    T r = x[i % x.size()] + 1;
+    keep(r);
+  });
+}
+
+// run in builds with and without -DBIG_INTEGER_SHARED_STORAGE=ON to compare
+void shared_storage() {
+  std::printf("shared storage %s\n", BIG_INTEGER_SHARED_STORAGE ? "on" : "off");
+  size_t const digits = 1000000;
+  std::vector<std::string> numbers = random_numbers(16, digits * 3322 / 1000, 8);
+  std::vector<big_integer> ours = parse<big_integer>(numbers);
+  std::vector<big_integer_gmp> gmp = parse<big_integer_gmp>(numbers);
+  std::string suffix = ", " + std::to_string(digits) + " digits";
+  report("copy a vector of 16" + suffix, vector_copy_loop(ours, 200), vector_copy_loop(gmp, 200));
+  report("merge_two copies" + suffix, merge_copies_loop(ours, 2000), merge_copies_loop(gmp, 2000));
+  report("a + 1" + suffix, by_value_sum_loop(ours, 2000), by_value_sum_loop(gmp, 2000));
+}
+
+template<typename T>
+double to_string_loop(std::vector<std::string> const& numbers, size_t iterations) {
+  std::vector<T> x = parse<T>(numbers);
+  return measure(iterations, [&](size_t i) {
+    std::string s = to_string(x[i % x.size()]);
+    keep(s);
+  });
+}
+
+template<typename T>
+double from_string_loop(std::vector<std::string> const& numbers, size_t iterations) {
+  return measure(iterations, [&](size_t i) {
+    T x(numbers[i % numbers.size()]);
+    keep(x);
+  });
+}
+
+// the operand sizes of the correctness_random tests, up to 1000 times larger
+void string_conversion() {
+  for (size_t bits = 2048; bits <= 2048000; bits *= 10) {
+    size_t iterations = std::max<size_t>(4, (size_t(1) << 30) / bits / 16);
+    std::vector<std::string> numbers = random_numbers(std::min<size_t>(iterations, 16), bits, 4);
+    std::string size = std::to_string(bits) + " bits";
+    report("to_string " + size, to_string_loop<big_integer>(numbers, iterations),
+           to_string_loop<big_integer_gmp>(numbers, iterations));
+    report("from string " + size, from_string_loop<big_integer>(numbers, iterations),
+           from_string_loop<big_integer_gmp>(numbers, iterations));
+  }
+}
+
+struct benchmark {
+  char const* name;
+  void (*run)();
+};
+
+benchmark const benchmarks[] = {
+    {"small_operands", small_operands},
+    {"small_values", small_values},
+    {"scalar_operands", scalar_operands},
+    {"fixed_width", fixed_width},
+    {"montgomery", montgomery},
+    {"exponentiation", exponentiation},
+    {"expression_chain", expression_chain},
+    {"basecase_kernels", basecase_kernels},
+    {"mul", mul},
+    {"mul_thresholds", mul_thresholds},
+    {"mul_allocations", mul_allocations},
+    {"fused_multiply", fused_multiply},
+    {"radix52_mul", radix52_mul},
+    {"parallel_mul", parallel_mul},
+    {"product_tree", product_tree},
+    {"arena", arena},
+    {"limb_pool", limb_pool},
+    {"shared_storage", shared_storage},
+    {"div", div},
+    {"div_thresholds", div_thresholds},
+    {"gcd", gcd},
+    {"gcd_thresholds", gcd_thresholds},
+    {"roots", roots},
+    {"string_conversion", string_conversion},
+};
+}
+
+int main(int argc, char** argv) {
+  char const* filter = argc > 1 ? argv[1] : "";
+  std::setvbuf(stdout, nullptr, _IOLBF, 0);
+  std::printf("kernels: %s (BIG_INTEGER_KERNELS selects another)\n", kernels::active_implementation().name);
+  std::printf("%-44s %15s %15s\n", "", "big_integer", "gmp");
+  for (benchmark const& b : benchmarks) {
+    if (std::strstr(b.name, filter) == nullptr)
+      continue;
+    std::printf("[%s]\n", b.name);
+    b.run();
+  }
+  return 0;
+}
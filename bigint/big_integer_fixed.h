@@ -0,0 +1,555 @@
+#ifndef BIG_INTEGER_FIXED_H
+#define BIG_INTEGER_FIXED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "big_integer.h"
+
+#if defined(__x86_64__)
+inline uint64_t fixed_div_2by1(uint64_t hi, uint64_t lo, uint64_t d, uint64_t& rem)
+{
+    uint64_t q;
+    asm("divq %4" : "=a"(q), "=d"(rem) : "0"(lo), "1"(hi), "rm"(d));
+    return q;
+}
+#endif
+
+// Integer of exactly Bits bits, two's complement when Signed, with the
+// operator set of big_integer. Values live in an array inside the object,
+// arithmetic wraps modulo 2^Bits like the built-in unsigned types, and all
+// operations except the conversions to and from strings and big_integer are
+// constexpr. The loops run over a compile-time number of limbs, which lets
+// the compiler unroll them.
+template<size_t Bits, bool Signed = true>
+struct fixed_big_integer
+{
+    static_assert(Bits != 0 && Bits % 64 == 0, "the width must be a positive multiple of 64 bits");
+
+    typedef uint64_t limb_t;
+    __extension__ typedef unsigned __int128 double_limb_t;
+
+    static size_t const limb_bits = 64;
+    static size_t const size = Bits / limb_bits;
+
+    constexpr fixed_big_integer()
+        : limbs{}
+    {}
+
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    constexpr fixed_big_integer(T value)
+        : limbs{}
+    {
+        static_assert(sizeof(T) <= sizeof(limb_t), "integer operands must fit in a limb");
+        limb_t fill = std::is_signed<T>::value && value < T(0) ? ~limb_t(0) : 0;
+        limbs[0] = static_cast<limb_t>(value);
+        for (size_t i = 1; i != size; ++i)
+        {
+            limbs[i] = fill;
+        }
+    }
+
+    // values outside the range are reduced modulo 2^Bits
+    explicit fixed_big_integer(big_integer const& value)
+        : limbs{}
+    {
+        size_t n = value.limbs.size() < size ? value.limbs.size() : size;
+        for (size_t i = 0; i != n; ++i)
+        {
+            limbs[i] = value.limbs[i];
+        }
+        if (value.negative)
+        {
+            *this = -*this;
+        }
+    }
+
+    explicit fixed_big_integer(std::string const& str)
+        : fixed_big_integer(big_integer(str))
+    {}
+
+    explicit operator big_integer() const
+    {
+        big_integer r;
+        bool negative = is_negative();
+        fixed_big_integer magnitude = negative ? -*this : *this;
+        r.limbs.assign(magnitude.limbs, magnitude.limbs + size);
+        r.negative = negative;
+        r.trim();
+        return r;
+    }
+
+    constexpr bool is_negative() const
+    {
+        return Signed && (limbs[size - 1] >> (limb_bits - 1)) != 0;
+    }
+
+    constexpr fixed_big_integer& operator+=(fixed_big_integer const& rhs)
+    {
+        limb_t carry = 0;
+        for (size_t i = 0; i != size; ++i)
+        {
+            double_limb_t s = static_cast<double_limb_t>(limbs[i]) + rhs.limbs[i] + carry;
+            limbs[i] = static_cast<limb_t>(s);
+            carry = static_cast<limb_t>(s >> limb_bits);
+        }
+        return *this;
+    }
+
+    constexpr fixed_big_integer& operator-=(fixed_big_integer const& rhs)
+    {
+        limb_t borrow = 0;
+        for (size_t i = 0; i != size; ++i)
+        {
+            double_limb_t d = static_cast<double_limb_t>(limbs[i]) - rhs.limbs[i] - borrow;
+            limbs[i] = static_cast<limb_t>(d);
+            borrow = static_cast<limb_t>(d >> limb_bits) & 1;
+        }
+        return *this;
+    }
+
+    // the low Bits bits of the product, which are the same for both
+    // signednesses, column by column
+    constexpr fixed_big_integer& operator*=(fixed_big_integer const& rhs)
+    {
+        fixed_big_integer r;
+        double_limb_t column = 0;
+        limb_t overflow = 0;
+#pragma GCC unroll 16
+        for (size_t k = 0; k != size; ++k)
+        {
+#pragma GCC unroll 16
+            for (size_t i = 0; i <= k; ++i)
+            {
+                double_limb_t p = static_cast<double_limb_t>(limbs[i]) * rhs.limbs[k - i];
+                column += p;
+                overflow += column < p;
+            }
+            r.limbs[k] = static_cast<limb_t>(column);
+            column = (column >> limb_bits) | (static_cast<double_limb_t>(overflow) << limb_bits);
+            overflow = 0;
+        }
+        return *this = r;
+    }
+
+    constexpr fixed_big_integer& operator/=(fixed_big_integer const& rhs)
+    {
+        fixed_big_integer q;
+        fixed_big_integer r;
+        divmod(*this, rhs, q, r);
+        return *this = q;
+    }
+
+    constexpr fixed_big_integer& operator%=(fixed_big_integer const& rhs)
+    {
+        fixed_big_integer q;
+        fixed_big_integer r;
+        divmod(*this, rhs, q, r);
+        return *this = r;
+    }
+
+    constexpr fixed_big_integer& operator&=(fixed_big_integer const& rhs)
+    {
+        for (size_t i = 0; i != size; ++i)
+        {
+            limbs[i] &= rhs.limbs[i];
+        }
+        return *this;
+    }
+
+    constexpr fixed_big_integer& operator|=(fixed_big_integer const& rhs)
+    {
+        for (size_t i = 0; i != size; ++i)
+        {
+            limbs[i] |= rhs.limbs[i];
+        }
+        return *this;
+    }
+
+    constexpr fixed_big_integer& operator^=(fixed_big_integer const& rhs)
+    {
+        for (size_t i = 0; i != size; ++i)
+        {
+            limbs[i] ^= rhs.limbs[i];
+        }
+        return *this;
+    }
+
+    constexpr fixed_big_integer& operator<<=(int rhs)
+    {
+        if (rhs < 0)
+        {
+            return *this >>= -rhs;
+        }
+        size_t shift = static_cast<size_t>(rhs);
+        size_t whole = shift / limb_bits;
+        unsigned bits = shift % limb_bits;
+        for (size_t i = size; i-- != 0;)
+        {
+            limb_t x = i >= whole ? limbs[i - whole] << bits : 0;
+            if (bits != 0 && i > whole)
+            {
+                x |= limbs[i - whole - 1] >> (limb_bits - bits);
+            }
+            limbs[i] = x;
+        }
+        return *this;
+    }
+
+    // arithmetic for signed values, rounding towards negative infinity
+    constexpr fixed_big_integer& operator>>=(int rhs)
+    {
+        if (rhs < 0)
+        {
+            return *this <<= -rhs;
+        }
+        limb_t fill = is_negative() ? ~limb_t(0) : 0;
+        size_t shift = static_cast<size_t>(rhs);
+        size_t whole = shift / limb_bits;
+        unsigned bits = shift % limb_bits;
+        for (size_t i = 0; i != size; ++i)
+        {
+            limb_t low = i + whole < size ? limbs[i + whole] : fill;
+            limb_t high = i + whole + 1 < size ? limbs[i + whole + 1] : fill;
+            limbs[i] = bits == 0 ? low : (low >> bits) | (high << (limb_bits - bits));
+        }
+        return *this;
+    }
+
+    constexpr fixed_big_integer operator+() const
+    {
+        return *this;
+    }
+
+    constexpr fixed_big_integer operator-() const
+    {
+        fixed_big_integer r;
+        r -= *this;
+        return r;
+    }
+
+    constexpr fixed_big_integer operator~() const
+    {
+        fixed_big_integer r;
+        for (size_t i = 0; i != size; ++i)
+        {
+            r.limbs[i] = ~limbs[i];
+        }
+        return r;
+    }
+
+    constexpr fixed_big_integer& operator++()
+    {
+        return *this += 1;
+    }
+
+    constexpr fixed_big_integer operator++(int)
+    {
+        fixed_big_integer r = *this;
+        ++*this;
+        return r;
+    }
+
+    constexpr fixed_big_integer& operator--()
+    {
+        return *this -= 1;
+    }
+
+    constexpr fixed_big_integer operator--(int)
+    {
+        fixed_big_integer r = *this;
+        --*this;
+        return r;
+    }
+
+    friend constexpr fixed_big_integer operator+(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a += b;
+    }
+
+    friend constexpr fixed_big_integer operator-(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a -= b;
+    }
+
+    friend constexpr fixed_big_integer operator*(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a *= b;
+    }
+
+    friend constexpr fixed_big_integer operator/(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a /= b;
+    }
+
+    friend constexpr fixed_big_integer operator%(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a %= b;
+    }
+
+    friend constexpr fixed_big_integer operator&(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a &= b;
+    }
+
+    friend constexpr fixed_big_integer operator|(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a |= b;
+    }
+
+    friend constexpr fixed_big_integer operator^(fixed_big_integer a, fixed_big_integer const& b)
+    {
+        return a ^= b;
+    }
+
+    friend constexpr fixed_big_integer operator<<(fixed_big_integer a, int b)
+    {
+        return a <<= b;
+    }
+
+    friend constexpr fixed_big_integer operator>>(fixed_big_integer a, int b)
+    {
+        return a >>= b;
+    }
+
+    // quotient and remainder of the truncating division a / b
+    friend constexpr void divmod(fixed_big_integer const& a, fixed_big_integer const& b,
+                                 fixed_big_integer& quotient, fixed_big_integer& remainder)
+    {
+        bool a_negative = a.is_negative();
+        bool b_negative = b.is_negative();
+        divmod_magnitude(a_negative ? -a : a, b_negative ? -b : b, quotient, remainder);
+        if (a_negative != b_negative)
+        {
+            quotient = -quotient;
+        }
+        if (a_negative)
+        {
+            remainder = -remainder;
+        }
+    }
+
+    friend constexpr bool operator==(fixed_big_integer const& a, fixed_big_integer const& b)
+    {
+        return compare(a, b) == 0;
+    }
+
+    friend constexpr bool operator!=(fixed_big_integer const& a, fixed_big_integer const& b)
+    {
+        return compare(a, b) != 0;
+    }
+
+    friend constexpr bool operator<(fixed_big_integer const& a, fixed_big_integer const& b)
+    {
+        return compare(a, b) < 0;
+    }
+
+    friend constexpr bool operator>(fixed_big_integer const& a, fixed_big_integer const& b)
+    {
+        return compare(a, b) > 0;
+    }
+
+    friend constexpr bool operator<=(fixed_big_integer const& a, fixed_big_integer const& b)
+    {
+        return compare(a, b) <= 0;
+    }
+
+    friend constexpr bool operator>=(fixed_big_integer const& a, fixed_big_integer const& b)
+    {
+        return compare(a, b) >= 0;
+    }
+
+    friend std::string to_string(fixed_big_integer const& a)
+    {
+        return to_string(static_cast<big_integer>(a));
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, fixed_big_integer const& a)
+    {
+        return s << to_string(a);
+    }
+
+private:
+    static constexpr int compare(fixed_big_integer const& a, fixed_big_integer const& b)
+    {
+        if (a.is_negative() != b.is_negative())
+        {
+            return a.is_negative() ? -1 : 1;
+        }
+        for (size_t i = size; i-- != 0;)
+        {
+            if (a.limbs[i] != b.limbs[i])
+            {
+                return a.limbs[i] < b.limbs[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    static constexpr size_t significant_limbs(fixed_big_integer const& a)
+    {
+        size_t n = size;
+        while (n != 0 && a.limbs[n - 1] == 0)
+        {
+            --n;
+        }
+        return n;
+    }
+
+    // divides (hi:lo) by d, requires hi < d; divq is not allowed in constant
+    // expressions, so those take the portable path
+    static constexpr limb_t div_2by1(limb_t hi, limb_t lo, limb_t d, limb_t& rem)
+    {
+#if defined(__x86_64__)
+        if (!__builtin_is_constant_evaluated())
+        {
+            return fixed_div_2by1(hi, lo, d, rem);
+        }
+#endif
+        double_limb_t n = (static_cast<double_limb_t>(hi) << limb_bits) | lo;
+        rem = static_cast<limb_t>(n % d);
+        return static_cast<limb_t>(n / d);
+    }
+
+    // the high limb of (hi:lo) << shift, shift < 64
+    static constexpr limb_t shift_left(limb_t lo, limb_t hi, unsigned shift)
+    {
+        return static_cast<limb_t>(((static_cast<double_limb_t>(hi) << limb_bits | lo) << shift) >> limb_bits);
+    }
+
+    // floor((2^128 - 1) / d) - 2^64 for d >= 2^63
+    static constexpr limb_t reciprocal(limb_t d)
+    {
+        limb_t rem = 0;
+        return div_2by1(~d, ~limb_t(0), d, rem);
+    }
+
+    // div_2by1 for d >= 2^63 by multiplication with v = reciprocal(d)
+    // (Moller and Granlund, "Improved division by invariant integers")
+    static constexpr limb_t div_2by1_preinv(limb_t hi, limb_t lo, limb_t d, limb_t v, limb_t& rem)
+    {
+        double_limb_t q = static_cast<double_limb_t>(v) * hi + ((static_cast<double_limb_t>(hi) << limb_bits) | lo);
+        limb_t q1 = static_cast<limb_t>(q >> limb_bits) + 1;
+        limb_t q0 = static_cast<limb_t>(q);
+        limb_t r = lo - q1 * d;
+        if (r > q0)
+        {
+            --q1;
+            r += d;
+        }
+        if (r >= d)
+        {
+            ++q1;
+            r -= d;
+        }
+        rem = r;
+        return q1;
+    }
+
+    // Knuth's algorithm D on the unsigned values of u and v
+    static constexpr void divmod_magnitude(fixed_big_integer const& u, fixed_big_integer const& v,
+                                           fixed_big_integer& q, fixed_big_integer& r)
+    {
+        size_t un = significant_limbs(u);
+        size_t vn = significant_limbs(v);
+        if (vn == 0)
+        {
+            throw std::runtime_error("division by zero");
+        }
+        q = fixed_big_integer();
+        r = fixed_big_integer();
+        if (un < vn)
+        {
+            r = u;
+            return;
+        }
+        if (vn == 1)
+        {
+            limb_t rem = 0;
+            for (size_t i = un; i-- != 0;)
+            {
+                q.limbs[i] = div_2by1(rem, u.limbs[i], v.limbs[0], rem);
+            }
+            r.limbs[0] = rem;
+            return;
+        }
+
+        unsigned shift = static_cast<unsigned>(__builtin_clzll(v.limbs[vn - 1]));
+        limb_t d[size] = {};
+        limb_t w[size + 1] = {};
+        for (size_t i = 0; i != vn; ++i)
+        {
+            d[i] = shift_left(i != 0 ? v.limbs[i - 1] : 0, v.limbs[i], shift);
+        }
+        for (size_t i = 0; i != un; ++i)
+        {
+            w[i] = shift_left(i != 0 ? u.limbs[i - 1] : 0, u.limbs[i], shift);
+        }
+        w[un] = shift_left(u.limbs[un - 1], 0, shift);
+
+        limb_t v_inverse = reciprocal(d[vn - 1]);
+        for (size_t j = un - vn + 1; j-- != 0;)
+        {
+            // w[j + vn] <= d[vn - 1], and on equality the quotient digit is at most 2^64 - 1
+            limb_t qhat = ~limb_t(0);
+            limb_t rhat = 0;
+            bool rhat_overflow = false;
+            if (w[j + vn] < d[vn - 1])
+            {
+                qhat = div_2by1_preinv(w[j + vn], w[j + vn - 1], d[vn - 1], v_inverse, rhat);
+            }
+            else
+            {
+                rhat = w[j + vn - 1] + d[vn - 1];
+                rhat_overflow = rhat < d[vn - 1];
+            }
+            while (!rhat_overflow && static_cast<double_limb_t>(qhat) * d[vn - 2]
+                                         > ((static_cast<double_limb_t>(rhat) << limb_bits) | w[j + vn - 2]))
+            {
+                --qhat;
+                rhat += d[vn - 1];
+                rhat_overflow = rhat < d[vn - 1];
+            }
+
+            limb_t carry = 0;
+            limb_t borrow = 0;
+            for (size_t i = 0; i != vn; ++i)
+            {
+                double_limb_t p = static_cast<double_limb_t>(qhat) * d[i] + carry;
+                carry = static_cast<limb_t>(p >> limb_bits);
+                double_limb_t t = static_cast<double_limb_t>(w[i + j]) - static_cast<limb_t>(p) - borrow;
+                w[i + j] = static_cast<limb_t>(t);
+                borrow = static_cast<limb_t>(t >> limb_bits) & 1;
+            }
+            double_limb_t t = static_cast<double_limb_t>(w[j + vn]) - carry - borrow;
+            w[j + vn] = static_cast<limb_t>(t);
+            if ((t >> limb_bits) != 0)
+            {
+                --qhat;
+                limb_t c = 0;
+                for (size_t i = 0; i != vn; ++i)
+                {
+                    double_limb_t s = static_cast<double_limb_t>(w[i + j]) + d[i] + c;
+                    w[i + j] = static_cast<limb_t>(s);
+                    c = static_cast<limb_t>(s >> limb_bits);
+                }
+                w[j + vn] += c;
+            }
+            q.limbs[j] = qhat;
+        }
+
+        for (size_t i = 0; i != vn; ++i)
+        {
+            r.limbs[i] = static_cast<limb_t>(((static_cast<double_limb_t>(w[i + 1]) << limb_bits) | w[i]) >> shift);
+        }
+    }
+
+    limb_t limbs[size];
+};
+
+#endif // BIG_INTEGER_FIXED_H
@@ -0,0 +1,663 @@
+#include "big_integer_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+// Greatest common divisors by Lehmer's algorithm, which takes as many
+// quotients of Euclid's algorithm as the leading bits of the operands
+// determine in each pass over the limbs. From hgcd_threshold limbs
+// (BIG_INTEGER_HGCD_THRESHOLD) the half-gcd of Schönhage, in Möller's
+// formulation, finds the reduction of the high halves recursively and applies
+// it by multiplication, in O(M(n) log n).
+//
+// Every reduction keeps (a; b) = T (u; v) for the inputs a, b, the current
+// pair u, v and a matrix T of non-negative entries with determinant +-1, so
+// gcd(u, v) = gcd(a, b) and the rows of T give the cofactors.
+
+#ifndef BIG_INTEGER_HGCD_THRESHOLD
+#define BIG_INTEGER_HGCD_THRESHOLD 100
+#endif
+
+namespace kernels
+{
+size_t hgcd_threshold = BIG_INTEGER_HGCD_THRESHOLD;
+
+namespace
+{
+typedef std::vector<limb_t> limbs_t;
+__extension__ typedef __int128 signed_double_limb_t;
+
+// leading bits the cosequence is simulated on, so that sums of them and of
+// the cofactors stay within int64_t
+unsigned const lehmer_bits = 62;
+
+size_t bit_length(limb_t const* a, size_t n)
+{
+    n = normalized_size(a, n);
+    return n == 0 ? 0 : n * limb_bits - static_cast<size_t>(__builtin_clzll(a[n - 1]));
+}
+
+size_t bit_length(limbs_t const& a)
+{
+    return bit_length(a.data(), a.size());
+}
+
+void normalize(limbs_t& a)
+{
+    a.resize(normalized_size(a.data(), a.size()));
+}
+
+// floor(a / 2^shift)
+limbs_t high_part(limbs_t const& a, size_t shift)
+{
+    size_t skip = shift / limb_bits;
+    if (skip >= a.size())
+    {
+        return limbs_t();
+    }
+    limbs_t r(a.begin() + static_cast<std::ptrdiff_t>(skip), a.end());
+    if (shift % limb_bits != 0)
+    {
+        rshift(r.data(), r.data(), r.size(), shift % limb_bits);
+    }
+    normalize(r);
+    return r;
+}
+
+// a mod 2^bits
+limbs_t low_part(limbs_t const& a, size_t bits)
+{
+    size_t n = (bits + limb_bits - 1) / limb_bits;
+    if (n > a.size() || (n == a.size() && bits % limb_bits == 0))
+    {
+        return a;
+    }
+    limbs_t r(a.begin(), a.begin() + static_cast<std::ptrdiff_t>(n));
+    if (bits % limb_bits != 0)
+    {
+        r[n - 1] &= (limb_t(1) << (bits % limb_bits)) - 1;
+    }
+    normalize(r);
+    return r;
+}
+
+// a 2^shift
+limbs_t shifted(limbs_t const& a, size_t shift)
+{
+    if (a.empty())
+    {
+        return a;
+    }
+    size_t skip = shift / limb_bits;
+    limbs_t r(skip + a.size() + 1);
+    if (shift % limb_bits != 0)
+    {
+        r.back() = lshift(r.data() + skip, a.data(), a.size(), shift % limb_bits);
+    }
+    else
+    {
+        std::copy(a.begin(), a.end(), r.begin() + static_cast<std::ptrdiff_t>(skip));
+    }
+    normalize(r);
+    return r;
+}
+
+// the bits of a[0..n) from shift upwards, of which there must be at most 64
+limb_t leading_bits(limb_t const* a, size_t n, size_t shift)
+{
+    size_t i = shift / limb_bits;
+    unsigned offset = shift % limb_bits;
+    limb_t x = i < n ? a[i] >> offset : 0;
+    if (offset != 0 && i + 1 < n)
+    {
+        x |= a[i + 1] << (limb_bits - offset);
+    }
+    return x;
+}
+
+limbs_t product(limbs_t const& a, limbs_t const& b)
+{
+    if (a.empty() || b.empty())
+    {
+        return limbs_t();
+    }
+    limbs_t r(a.size() + b.size());
+    if (a.size() >= b.size())
+    {
+        mul(r.data(), a.data(), a.size(), b.data(), b.size());
+    }
+    else
+    {
+        mul(r.data(), b.data(), b.size(), a.data(), a.size());
+    }
+    normalize(r);
+    return r;
+}
+
+limbs_t sum(limbs_t const& a, limbs_t const& b)
+{
+    if (a.size() < b.size())
+    {
+        return sum(b, a);
+    }
+    limbs_t r(a.size() + 1);
+    r[a.size()] = add(r.data(), a.data(), a.size(), b.data(), b.size());
+    normalize(r);
+    return r;
+}
+
+// a - b for a >= b
+limbs_t difference(limbs_t const& a, limbs_t const& b)
+{
+    limbs_t r(a.size());
+    sub(r.data(), a.data(), a.size(), b.data(), b.size());
+    normalize(r);
+    return r;
+}
+
+// the reduction of a pair a, b to u, v with (a; b) = [[m00, m01], [m10, m11]] (u; v)
+struct reduction
+{
+    limbs_t m[2][2];
+    bool negative_determinant;
+    limbs_t u;
+    limbs_t v;
+};
+
+// a row (x, y) of T, with x and y of the same length
+struct cofactors
+{
+    limbs_t x;
+    limbs_t y;
+};
+
+void pad(cofactors& r)
+{
+    size_t n = std::max(r.x.size(), r.y.size());
+    r.x.resize(n);
+    r.y.resize(n);
+}
+
+void trim(cofactors& r)
+{
+    size_t n = std::max(normalized_size(r.x.data(), r.x.size()), normalized_size(r.y.data(), r.y.size()));
+    r.x.resize(n);
+    r.y.resize(n);
+}
+
+// (x, y) = (x, y) [[p00, p01], [p10, p11]] for entries below 2^62
+void multiply_row(cofactors& r, limb_t p00, limb_t p01, limb_t p10, limb_t p11)
+{
+    size_t n = r.x.size();
+    limb_t* x = r.x.data();
+    limb_t* y = r.y.data();
+    double_limb_t cx = 0;
+    double_limb_t cy = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        cx += static_cast<double_limb_t>(x[i]) * p00 + static_cast<double_limb_t>(y[i]) * p10;
+        cy += static_cast<double_limb_t>(x[i]) * p01 + static_cast<double_limb_t>(y[i]) * p11;
+        x[i] = static_cast<limb_t>(cx);
+        y[i] = static_cast<limb_t>(cy);
+        cx >>= limb_bits;
+        cy >>= limb_bits;
+    }
+    if (cx != 0 || cy != 0)
+    {
+        r.x.push_back(static_cast<limb_t>(cx));
+        r.y.push_back(static_cast<limb_t>(cy));
+    }
+}
+
+// (x, y) = (x, y) [[q, 1], [1, 0]] = (q x + y, x)
+void divide_row(cofactors& r, limbs_t const& q, limbs_t& scratch)
+{
+    size_t n = r.x.size();
+    size_t xn = normalized_size(r.x.data(), n);
+    scratch.assign(std::max(n, xn + q.size()) + 1, 0);
+    if (xn >= q.size())
+    {
+        mul(scratch.data(), r.x.data(), xn, q.data(), q.size());
+    }
+    else if (xn != 0)
+    {
+        mul(scratch.data(), q.data(), q.size(), r.x.data(), xn);
+    }
+    size_t m = scratch.size() - 1;
+    scratch[m] = add(scratch.data(), scratch.data(), m, r.y.data(), n);
+    r.y.swap(r.x);
+    r.x.swap(scratch);
+    pad(r);
+    trim(r);
+}
+
+// (x, y) = (x, y) m
+void multiply_row(cofactors& r, limbs_t const (&m)[2][2])
+{
+    normalize(r.x);
+    normalize(r.y);
+    limbs_t x = sum(product(r.x, m[0][0]), product(r.y, m[1][0]));
+    r.y = sum(product(r.x, m[0][1]), product(r.y, m[1][1]));
+    r.x.swap(x);
+    pad(r);
+}
+
+// floor(x / y) for x >= 0, y > 0, by subtraction for the small quotients
+// that make up most of Euclid's algorithm
+int64_t quotient(int64_t x, int64_t y)
+{
+    for (int64_t q = 0; q != 3; ++q)
+    {
+        if (x < y)
+        {
+            return q;
+        }
+        x -= y;
+    }
+    return x / y + 3;
+}
+
+// (u'; v') = [[a, b], [c, d]] (u; v), where a and b, and c and d, have
+// opposite signs or are zero
+struct cosequence
+{
+    int64_t a;
+    int64_t b;
+    int64_t c;
+    int64_t d;
+    bool negative_determinant;
+};
+
+// The quotients of Euclid's algorithm on u >= v from uh = floor(u / 2^k)
+// and vh = floor(v / 2^k), as far as they are the same for all u and v with
+// these leading bits (Knuth, TAOCP 4.5.2, algorithm L), or from u and v
+// themselves when exact. A quotient is taken only if the remainder v' it
+// leaves is known to be at least bound 2^k.
+cosequence simulate(int64_t uh, int64_t vh, bool exact, int64_t bound)
+{
+    cosequence k = {1, 0, 0, 1, false};
+    for (;;)
+    {
+        int64_t q;
+        if (exact)
+        {
+            if (vh == 0)
+            {
+                break;
+            }
+            q = quotient(uh, vh);
+        }
+        else
+        {
+            int64_t low = vh + k.c;
+            int64_t high = vh + k.d;
+            if (low <= 0 || high <= 0)
+            {
+                break;
+            }
+            q = quotient(uh + k.a, low);
+            int64_t z = uh + k.b;
+            double_limb_t p = static_cast<double_limb_t>(q) * static_cast<limb_t>(high);
+            if (q == 0 || z < 0 || p > static_cast<limb_t>(z) || static_cast<limb_t>(z) - p >= static_cast<limb_t>(high))
+            {
+                break;
+            }
+        }
+        int64_t r = uh - q * vh;
+        int64_t c = k.a - q * k.c;
+        int64_t d = k.b - q * k.d;
+        // v' = r 2^k + c (u mod 2^k) + d (v mod 2^k), which is more than
+        // (r - max(|c|, |d|)) 2^k
+        if ((exact ? r : r - std::max(std::abs(c), std::abs(d))) < bound)
+        {
+            break;
+        }
+        k = {k.c, k.d, c, d, !k.negative_determinant};
+        uh = vh;
+        vh = r;
+    }
+    return k;
+}
+
+// Euclid's algorithm on the pair u >= v, with the rows of T kept along as
+// far as the caller asks for them. u has no leading zero limbs and v is
+// zero-padded to its length.
+struct euclid
+{
+    euclid(limbs_t const& a, limbs_t const& b, std::vector<cofactors> const& rows);
+
+    size_t bits() const;
+
+    // one Lehmer pass, or one division if the leading bits determine no
+    // quotient; false if none is possible that leaves v at least 2^s
+    bool step(size_t s);
+    bool divide(size_t s);
+    // (u; v) = m^-1 (u; v) and T = T m for a reduction r of u and v shifted
+    // right by p bits
+    void reduce(reduction const& r, size_t p);
+
+    reduction result() const;
+
+    limbs_t u;
+    limbs_t v;
+    std::vector<cofactors> rows;
+    bool negative_determinant;
+
+private:
+    void order();
+    void apply(cosequence const& k);
+
+    limbs_t scratch0;
+    limbs_t scratch1;
+};
+
+euclid::euclid(limbs_t const& a, limbs_t const& b, std::vector<cofactors> const& rows)
+    : u(a)
+    , v(b)
+    , rows(rows)
+    , negative_determinant(false)
+{
+    for (cofactors& r : this->rows)
+    {
+        pad(r);
+    }
+    order();
+}
+
+size_t euclid::bits() const
+{
+    return bit_length(u);
+}
+
+void euclid::order()
+{
+    size_t n = std::max(normalized_size(u.data(), u.size()), normalized_size(v.data(), v.size()));
+    u.resize(n);
+    v.resize(n);
+    if (cmp(u.data(), v.data(), n) < 0)
+    {
+        u.swap(v);
+        for (cofactors& r : rows)
+        {
+            r.x.swap(r.y);
+        }
+        negative_determinant = !negative_determinant;
+    }
+}
+
+void euclid::apply(cosequence const& k)
+{
+    // (u; v) = [[a, b], [c, d]] (u; v) in one pass, where the products of
+    // the 62-bit coefficients and their sums fit in 128 bits
+    size_t n = u.size();
+    signed_double_limb_t cu = 0;
+    signed_double_limb_t cv = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        signed_double_limb_t x = u[i];
+        signed_double_limb_t y = v[i];
+        cu += k.a * x + k.b * y;
+        cv += k.c * x + k.d * y;
+        u[i] = static_cast<limb_t>(cu);
+        v[i] = static_cast<limb_t>(cv);
+        cu >>= limb_bits;
+        cv >>= limb_bits;
+    }
+    n = normalized_size(u.data(), n);
+    u.resize(n);
+    v.resize(n);
+    // T [[a, b], [c, d]]^-1 = T [[|d|, |b|], [|c|, |a|]]
+    for (cofactors& r : rows)
+    {
+        multiply_row(r, static_cast<limb_t>(std::abs(k.d)), static_cast<limb_t>(std::abs(k.b)),
+                     static_cast<limb_t>(std::abs(k.c)), static_cast<limb_t>(std::abs(k.a)));
+    }
+    negative_determinant = negative_determinant != k.negative_determinant;
+}
+
+bool euclid::step(size_t s)
+{
+    size_t length = bits();
+    size_t shift = length > lehmer_bits ? length - lehmer_bits : 0;
+    int64_t uh = static_cast<int64_t>(leading_bits(u.data(), u.size(), shift));
+    int64_t vh = static_cast<int64_t>(leading_bits(v.data(), v.size(), shift));
+    if (vh == 0)
+    {
+        return divide(s);
+    }
+    int64_t bound = shift >= s ? 1 : s - shift >= lehmer_bits ? INT64_MAX : int64_t(1) << (s - shift);
+    cosequence k = simulate(uh, vh, shift == 0, bound);
+    if (k.b == 0)
+    {
+        return divide(s);
+    }
+    apply(k);
+    return true;
+}
+
+bool euclid::divide(size_t s)
+{
+    size_t n = u.size();
+    size_t vn = normalized_size(v.data(), n);
+    if (vn == 0)
+    {
+        return false;
+    }
+    limbs_t q(n - vn + 1);
+    scratch0.resize(vn);
+    if (vn == 1)
+    {
+        scratch0[0] = divrem_1(q.data(), u.data(), n, v[0]);
+    }
+    else
+    {
+        divrem(q.data(), scratch0.data(), u.data(), n, v.data(), vn);
+    }
+    if (bit_length(scratch0) <= s)
+    {
+        return false;
+    }
+    u.swap(v);
+    u.resize(vn);
+    v.swap(scratch0);
+    normalize(q);
+    for (cofactors& r : rows)
+    {
+        divide_row(r, q, scratch1);
+    }
+    negative_determinant = !negative_determinant;
+    return true;
+}
+
+void euclid::reduce(reduction const& r, size_t p)
+{
+    // m^-1 (u; v) = 2^p m^-1 (u_high; v_high) + m^-1 (u_low; v_low), where
+    // the first term is (r.u; r.v) and m^-1 = det m [[m11, -m01], [-m10, m00]]
+    limbs_t u_low = low_part(u, p);
+    limbs_t v_low = low_part(v, p);
+    limbs_t x = product(r.m[1][1], u_low);
+    limbs_t y = product(r.m[0][1], v_low);
+    limbs_t z = product(r.m[0][0], v_low);
+    limbs_t w = product(r.m[1][0], u_low);
+    if (r.negative_determinant)
+    {
+        x.swap(y);
+        z.swap(w);
+    }
+    u = difference(sum(shifted(r.u, p), x), y);
+    v = difference(sum(shifted(r.v, p), z), w);
+    for (cofactors& row : rows)
+    {
+        multiply_row(row, r.m);
+    }
+    negative_determinant = negative_determinant != r.negative_determinant;
+    order();
+}
+
+reduction euclid::result() const
+{
+    reduction r;
+    for (size_t i = 0; i != 2; ++i)
+    {
+        r.m[i][0] = rows[i].x;
+        r.m[i][1] = rows[i].y;
+        normalize(r.m[i][0]);
+        normalize(r.m[i][1]);
+    }
+    r.negative_determinant = negative_determinant;
+    r.u = u;
+    r.v = v;
+    normalize(r.u);
+    normalize(r.v);
+    return r;
+}
+
+// Reduces a and b, which must both be at least 2^s, as far as they stay at
+// least 2^s, and returns the reduction in r; false if no step was possible.
+//
+// With a, b < 2^n split at bit p, a reduction M of the high parts that keeps
+// them at least 2^t has entries below 2^(n - p - t). Applied to a and b it
+// leaves them at least 2^(p + t) - 2^(n - t), which is at least 2^(p + t - 1)
+// if 2 t > n - p. That is what both recursive calls rely on.
+bool hgcd(limbs_t const& a, limbs_t const& b, size_t s, reduction& result)
+{
+    if (bit_length(a) <= s || bit_length(b) <= s)
+    {
+        return false;
+    }
+    std::vector<cofactors> identity(2);
+    identity[0].x.assign(1, 1);
+    identity[1].y.assign(1, 1);
+    euclid e(a, b, identity);
+    bool reduced = false;
+    if (e.u.size() >= std::max<size_t>(hgcd_threshold, 2))
+    {
+        // the high halves down to a quarter of the bits
+        size_t n = e.bits();
+        reduction r;
+        if (hgcd(high_part(e.u, s), high_part(e.v, s), (n - s) / 2 + 1, r))
+        {
+            e.reduce(r, s);
+            reduced = true;
+        }
+        while (e.bits() > 3 * n / 4 + 1)
+        {
+            // nothing left to reduce, the second half would search in vain
+            if (!e.step(s))
+            {
+                result = e.result();
+                return reduced;
+            }
+            reduced = true;
+        }
+        // and the remaining 2 (n' - s) bits at the top down to s
+        size_t n2 = e.bits();
+        if (n2 <= 2 * s)
+        {
+            size_t p = 2 * s + 1 - n2;
+            if (hgcd(high_part(e.u, p), high_part(e.v, p), n2 - s, r))
+            {
+                e.reduce(r, p);
+                reduced = true;
+            }
+        }
+    }
+    while (e.step(s))
+    {
+        reduced = true;
+    }
+    result = e.result();
+    return reduced;
+}
+
+// runs e down to v = gcd(a, b), where u mod v = 0
+void run(euclid& e)
+{
+    for (;;)
+    {
+        size_t vn = normalized_size(e.v.data(), e.v.size());
+        if (vn < std::max<size_t>(hgcd_threshold, 2))
+        {
+            break;
+        }
+        size_t n = e.bits();
+        size_t p = n / 2;
+        reduction r;
+        if (hgcd(high_part(e.u, p), high_part(e.v, p), (n - p) / 2 + 1, r))
+        {
+            e.reduce(r, p);
+        }
+        else if (!e.divide(0))
+        {
+            return;
+        }
+    }
+    while (e.step(0))
+    {
+    }
+}
+
+limb_t gcd_1(limb_t a, limb_t b)
+{
+    if (a == 0 || b == 0)
+    {
+        return a | b;
+    }
+    int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    while (b != 0)
+    {
+        b >>= __builtin_ctzll(b);
+        if (a > b)
+        {
+            std::swap(a, b);
+        }
+        b -= a;
+    }
+    return a << shift;
+}
+
+limb_t mod_1(limb_t const* a, size_t n, limb_t d)
+{
+    limb_t r = 0;
+    for (size_t i = n; i-- != 0;)
+    {
+        r = static_cast<limb_t>(((static_cast<double_limb_t>(r) << limb_bits) | a[i]) % d);
+    }
+    return r;
+}
+}
+
+size_t gcd(limb_t* g, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    if (an == 1 || bn == 1)
+    {
+        g[0] = an == 1 ? gcd_1(a[0], mod_1(b, bn, a[0])) : gcd_1(b[0], mod_1(a, an, b[0]));
+        return 1;
+    }
+    euclid e(limbs_t(a, a + an), limbs_t(b, b + bn), std::vector<cofactors>());
+    run(e);
+    size_t gn = normalized_size(e.v.data(), e.v.size());
+    std::copy(e.v.begin(), e.v.begin() + static_cast<std::ptrdiff_t>(gn), g);
+    return gn;
+}
+
+size_t gcdext(limb_t* g, limb_t* s, size_t* sn, bool* s_negative, limb_t const* a, size_t an, limb_t const* b,
+              size_t bn)
+{
+    // the second row of T, since v = det T (b T00 - a T10) at the end
+    std::vector<cofactors> rows(1);
+    rows[0].y.assign(1, 1);
+    euclid e(limbs_t(a, a + an), limbs_t(b, b + bn), rows);
+    run(e);
+    size_t gn = normalized_size(e.v.data(), e.v.size());
+    std::copy(e.v.begin(), e.v.begin() + static_cast<std::ptrdiff_t>(gn), g);
+    limbs_t const& x = e.rows[0].x;
+    *sn = normalized_size(x.data(), x.size());
+    std::copy(x.begin(), x.begin() + static_cast<std::ptrdiff_t>(*sn), s);
+    *s_negative = *sn != 0 && !e.negative_determinant;
+    return gn;
+}
+}
@@ -11,6 +11,11 @@ big_integer_gmp::big_integer_gmp(big_integer_gmp const& other) {
   mpz_init_set(mpz, other.mpz);
 }
 
+big_integer_gmp::big_integer_gmp(big_integer_gmp&& other) noexcept {
+  mpz_init(mpz);
+  mpz_swap(mpz, other.mpz);
+}
+
 big_integer_gmp::big_integer_gmp(int a) {
   mpz_init_set_si(mpz, a);
 }
@@ -31,6 +36,11 @@ big_integer_gmp& big_integer_gmp::operator=(big_integer_gmp const& other) {
   return *this;
 }
 
+big_integer_gmp& big_integer_gmp::operator=(big_integer_gmp&& other) noexcept {
+  mpz_swap(mpz, other.mpz);
+  return *this;
+}
+
 big_integer_gmp& big_integer_gmp::operator+=(big_integer_gmp const& rhs) {
   mpz_add(mpz, mpz, rhs.mpz);
   return *this;
@@ -46,6 +56,16 @@ big_integer_gmp& big_integer_gmp::operator*=(big_integer_gmp const& rhs) {
   return *this;
 }
 
+big_integer_gmp& big_integer_gmp::addmul(big_integer_gmp const& a, big_integer_gmp const& b) {
+  mpz_addmul(mpz, a.mpz, b.mpz);
+  return *this;
+}
+
+big_integer_gmp& big_integer_gmp::submul(big_integer_gmp const& a, big_integer_gmp const& b) {
+  mpz_submul(mpz, a.mpz, b.mpz);
+  return *this;
+}
+
 big_integer_gmp& big_integer_gmp::operator/=(big_integer_gmp const& rhs) {
   mpz_tdiv_q(mpz, mpz, rhs.mpz);
   return *this;
@@ -120,43 +140,134 @@ big_integer_gmp big_integer_gmp::operator--(int) {
 }
 
 big_integer_gmp operator+(big_integer_gmp a, big_integer_gmp const& b) {
-  return a += b;
+  a += b;
+  return a;
 }
 
 big_integer_gmp operator-(big_integer_gmp a, big_integer_gmp const& b) {
-  return a -= b;
+  a -= b;
+  return a;
 }
 
 big_integer_gmp operator*(big_integer_gmp a, big_integer_gmp const& b) {
-  return a *= b;
+  a *= b;
+  return a;
+}
+
+void mul(big_integer_gmp& r, big_integer_gmp const& a, big_integer_gmp const& b) {
+  mpz_mul(r.mpz, a.mpz, b.mpz);
 }
 
 big_integer_gmp operator/(big_integer_gmp a, big_integer_gmp const& b) {
-  return a /= b;
+  a /= b;
+  return a;
 }
 
 big_integer_gmp operator%(big_integer_gmp a, big_integer_gmp const& b) {
-  return a %= b;
+  a %= b;
+  return a;
+}
+
+std::pair<big_integer_gmp, big_integer_gmp> divmod(big_integer_gmp const& a, big_integer_gmp const& b) {
+  std::pair<big_integer_gmp, big_integer_gmp> result;
+  mpz_tdiv_qr(result.first.mpz, result.second.mpz, a.mpz, b.mpz);
+  return result;
+}
+
+big_integer_gmp gcd(big_integer_gmp const& a, big_integer_gmp const& b) {
+  big_integer_gmp r;
+  mpz_gcd(r.mpz, a.mpz, b.mpz);
+  return r;
+}
+
+big_integer_gmp lcm(big_integer_gmp const& a, big_integer_gmp const& b) {
+  big_integer_gmp r;
+  mpz_lcm(r.mpz, a.mpz, b.mpz);
+  return r;
+}
+
+big_integer_gmp gcdext(big_integer_gmp const& a, big_integer_gmp const& b, big_integer_gmp* s, big_integer_gmp* t) {
+  big_integer_gmp g;
+  mpz_gcdext(g.mpz, s != nullptr ? s->mpz : nullptr, t != nullptr ? t->mpz : nullptr, a.mpz, b.mpz);
+  return g;
+}
+
+big_integer_gmp modinv(big_integer_gmp const& a, big_integer_gmp const& modulus) {
+  big_integer_gmp r;
+  if (mpz_sgn(modulus.mpz) <= 0 || mpz_invert(r.mpz, a.mpz, modulus.mpz) == 0)
+    throw std::runtime_error("not invertible");
+  return r;
+}
+
+big_integer_gmp isqrt(big_integer_gmp const& a) {
+  if (mpz_sgn(a.mpz) < 0)
+    throw std::runtime_error("invalid root");
+  big_integer_gmp r;
+  mpz_sqrt(r.mpz, a.mpz);
+  return r;
+}
+
+big_integer_gmp iroot(big_integer_gmp const& a, unsigned k) {
+  if (k == 0 || (k % 2 == 0 && mpz_sgn(a.mpz) < 0))
+    throw std::runtime_error("invalid root");
+  big_integer_gmp r;
+  mpz_root(r.mpz, a.mpz, k);
+  return r;
+}
+
+bool is_perfect_square(big_integer_gmp const& a) {
+  return mpz_perfect_square_p(a.mpz) != 0;
+}
+
+big_integer_gmp product(std::vector<big_integer_gmp> factors) {
+  if (factors.empty())
+    return 1;
+  while (factors.size() != 1) {
+    size_t pairs = factors.size() / 2;
+    for (size_t i = 0; i != pairs; ++i)
+      mpz_mul(factors[i].mpz, factors[2 * i].mpz, factors[2 * i + 1].mpz);
+    if (factors.size() % 2 != 0)
+      mpz_swap(factors[pairs].mpz, factors.back().mpz);
+    factors.resize(factors.size() - pairs);
+  }
+  return factors[0];
+}
+
+big_integer_gmp powmod(big_integer_gmp const& base, big_integer_gmp const& exponent, big_integer_gmp const& modulus) {
+  big_integer_gmp r;
+  mpz_powm(r.mpz, base.mpz, exponent.mpz, modulus.mpz);
+  return r;
+}
+
+big_integer_gmp powmod_ct(big_integer_gmp const& base, big_integer_gmp const& exponent, big_integer_gmp const& modulus) {
+  big_integer_gmp r;
+  mpz_powm_sec(r.mpz, base.mpz, exponent.mpz, modulus.mpz);
+  return r;
 }
 
 big_integer_gmp operator&(big_integer_gmp a, big_integer_gmp const& b) {
-  return a &= b;
+  a &= b;
+  return a;
 }
 
 big_integer_gmp operator|(big_integer_gmp a, big_integer_gmp const& b) {
-  return a |= b;
+  a |= b;
+  return a;
 }
 
 big_integer_gmp operator^(big_integer_gmp a, big_integer_gmp const& b) {
-  return a ^= b;
+  a ^= b;
+  return a;
 }
 
 big_integer_gmp operator<<(big_integer_gmp a, int b) {
-  return a <<= b;
+  a <<= b;
+  return a;
 }
 
 big_integer_gmp operator>>(big_integer_gmp a, int b) {
-  return a >>= b;
+  a >>= b;
+  return a;
 }
 
 bool operator==(big_integer_gmp const& a, big_integer_gmp const& b) {
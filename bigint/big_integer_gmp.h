@@ -4,10 +4,13 @@
 #include <cstddef>
 #include <gmp.h>
 #include <iosfwd>
+#include <utility>
+#include <vector>
 
 struct big_integer_gmp {
   big_integer_gmp();
   big_integer_gmp(big_integer_gmp const& other);
+  big_integer_gmp(big_integer_gmp&& other) noexcept;
   big_integer_gmp(int a);
   explicit big_integer_gmp(std::string const& str);
 
@@ -27,6 +30,7 @@ struct big_integer_gmp {
   ~big_integer_gmp();
 
   big_integer_gmp& operator=(big_integer_gmp const& other);
+  big_integer_gmp& operator=(big_integer_gmp&& other) noexcept;
 
   big_integer_gmp& operator+=(big_integer_gmp const& rhs);
   big_integer_gmp& operator-=(big_integer_gmp const& rhs);
@@ -34,6 +38,9 @@ struct big_integer_gmp {
   big_integer_gmp& operator/=(big_integer_gmp const& rhs);
   big_integer_gmp& operator%=(big_integer_gmp const& rhs);
 
+  big_integer_gmp& addmul(big_integer_gmp const& a, big_integer_gmp const& b);
+  big_integer_gmp& submul(big_integer_gmp const& a, big_integer_gmp const& b);
+
   big_integer_gmp& operator&=(big_integer_gmp const& rhs);
   big_integer_gmp& operator|=(big_integer_gmp const& rhs);
   big_integer_gmp& operator^=(big_integer_gmp const& rhs);
@@ -58,6 +65,22 @@ struct big_integer_gmp {
   friend bool operator<=(big_integer_gmp const& a, big_integer_gmp const& b);
   friend bool operator>=(big_integer_gmp const& a, big_integer_gmp const& b);
 
+  friend void mul(big_integer_gmp& r, big_integer_gmp const& a, big_integer_gmp const& b);
+  friend std::pair<big_integer_gmp, big_integer_gmp> divmod(big_integer_gmp const& a, big_integer_gmp const& b);
+  friend big_integer_gmp gcd(big_integer_gmp const& a, big_integer_gmp const& b);
+  friend big_integer_gmp lcm(big_integer_gmp const& a, big_integer_gmp const& b);
+  friend big_integer_gmp gcdext(big_integer_gmp const& a, big_integer_gmp const& b, big_integer_gmp* s,
+                                big_integer_gmp* t);
+  friend big_integer_gmp modinv(big_integer_gmp const& a, big_integer_gmp const& modulus);
+  friend big_integer_gmp isqrt(big_integer_gmp const& a);
+  friend big_integer_gmp iroot(big_integer_gmp const& a, unsigned k);
+  friend bool is_perfect_square(big_integer_gmp const& a);
+  friend big_integer_gmp product(std::vector<big_integer_gmp> factors);
+  friend big_integer_gmp powmod(big_integer_gmp const& base, big_integer_gmp const& exponent,
+                                big_integer_gmp const& modulus);
+  friend big_integer_gmp powmod_ct(big_integer_gmp const& base, big_integer_gmp const& exponent,
+                                   big_integer_gmp const& modulus);
+
   friend std::string to_string(big_integer_gmp const& a);
 
  private:
@@ -70,6 +93,23 @@ big_integer_gmp operator*(big_integer_gmp a, big_integer_gmp const& b);
 big_integer_gmp operator/(big_integer_gmp a, big_integer_gmp const& b);
 big_integer_gmp operator%(big_integer_gmp a, big_integer_gmp const& b);
 
+void mul(big_integer_gmp& r, big_integer_gmp const& a, big_integer_gmp const& b);
+
+std::pair<big_integer_gmp, big_integer_gmp> divmod(big_integer_gmp const& a, big_integer_gmp const& b);
+
+big_integer_gmp gcd(big_integer_gmp const& a, big_integer_gmp const& b);
+big_integer_gmp lcm(big_integer_gmp const& a, big_integer_gmp const& b);
+big_integer_gmp gcdext(big_integer_gmp const& a, big_integer_gmp const& b, big_integer_gmp* s, big_integer_gmp* t);
+big_integer_gmp modinv(big_integer_gmp const& a, big_integer_gmp const& modulus);
+
+big_integer_gmp isqrt(big_integer_gmp const& a);
+big_integer_gmp iroot(big_integer_gmp const& a, unsigned k);
+bool is_perfect_square(big_integer_gmp const& a);
+big_integer_gmp product(std::vector<big_integer_gmp> factors);
+
+big_integer_gmp powmod(big_integer_gmp const& base, big_integer_gmp const& exponent, big_integer_gmp const& modulus);
+big_integer_gmp powmod_ct(big_integer_gmp const& base, big_integer_gmp const& exponent, big_integer_gmp const& modulus);
+
 big_integer_gmp operator&(big_integer_gmp a, big_integer_gmp const& b);
 big_integer_gmp operator|(big_integer_gmp a, big_integer_gmp const& b);
 big_integer_gmp operator^(big_integer_gmp a, big_integer_gmp const& b);
@@ -0,0 +1,203 @@
+#include "big_integer_kernels.h"
+
+#include <algorithm>
+
+// Products in radix 2^52 with the AVX-512 IFMA instructions, which multiply
+// eight pairs of 52-bit digits per instruction and add the low (vpmadd52luq)
+// or high (vpmadd52huq) 52 bits of the products to 64-bit accumulators. The
+// operands are split into 52-bit digits and the product is formed by columns,
+// sixteen at a time in four registers: column k + t collects a[k + t - j] b[j]
+// over j, so each digit of b is broadcast once and multiplied with a window of
+// a loaded at offset k - j from a copy padded with zeros on both sides. Each
+// accumulator takes at most min(an, bn) 52-bit terms per digit, so operands
+// below 2^12 digits cannot overflow it. The carries are propagated in a single
+// pass that also repacks the digits into limbs. The padded digits of both
+// operands and the columns live in the scratch space of the caller.
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define BIG_INTEGER_X86_IFMA 1
+#else
+#define BIG_INTEGER_X86_IFMA 0
+#endif
+
+#ifndef BIG_INTEGER_IFMA_THRESHOLD
+#define BIG_INTEGER_IFMA_THRESHOLD 24
+#endif
+
+#ifndef BIG_INTEGER_IFMA_KARATSUBA_THRESHOLD
+#define BIG_INTEGER_IFMA_KARATSUBA_THRESHOLD 256
+#endif
+
+namespace kernels
+{
+size_t ifma_threshold = BIG_INTEGER_IFMA_THRESHOLD;
+size_t ifma_karatsuba_threshold = BIG_INTEGER_IFMA_KARATSUBA_THRESHOLD;
+
+namespace
+{
+typedef limb_t digit_t;
+
+unsigned const digit_bits = 52;
+digit_t const digit_mask = (digit_t(1) << digit_bits) - 1;
+
+// zero digits on either side of a, enough for the windows of two blocks
+size_t const padding = 16;
+
+size_t digit_count(size_t n)
+{
+    return (n * limb_bits + digit_bits - 1) / digit_bits;
+}
+
+size_t block_count(size_t an, size_t bn)
+{
+    return (digit_count(an) + digit_count(bn) + 15) / 16;
+}
+}
+
+size_t radix52_scratch_size(size_t an, size_t bn)
+{
+    return padding + digit_count(an) + padding + digit_count(bn) + 2 * 16 * block_count(an, bn);
+}
+
+namespace x86_ifma
+{
+#if BIG_INTEGER_X86_IFMA
+
+namespace
+{
+// d[0..digit_count(n)) = a[0..n) in radix 2^52
+void to_digits(digit_t* d, limb_t const* a, size_t n)
+{
+    double_limb_t bits = 0;
+    unsigned count = 0;
+    for (size_t i = 0, k = 0, m = digit_count(n); k != m; ++k)
+    {
+        if (count < digit_bits)
+        {
+            bits |= static_cast<double_limb_t>(i != n ? a[i++] : 0) << count;
+            count += limb_bits;
+        }
+        d[k] = static_cast<digit_t>(bits) & digit_mask;
+        bits >>= digit_bits;
+        count -= digit_bits;
+    }
+}
+
+// lo[k] and hi[k] for the columns k in [0, 16 blocks): the sums of the low and
+// high halves of a[i] b[j] over i + j = k, with a padded as above
+__attribute__((target("avx512f,avx512ifma"))) void columns(digit_t* lo, digit_t* hi, digit_t const* a, size_t am,
+                                                           digit_t const* b, size_t bm, size_t blocks)
+{
+    for (size_t block = 0; block != blocks; ++block)
+    {
+        size_t k = 16 * block;
+        __m512i lo0 = _mm512_setzero_si512();
+        __m512i hi0 = _mm512_setzero_si512();
+        __m512i lo1 = _mm512_setzero_si512();
+        __m512i hi1 = _mm512_setzero_si512();
+        size_t first = k + 1 > am ? k + 1 - am : 0;
+        size_t last = std::min(bm, k + 16);
+        for (size_t j = first; j < last; ++j)
+        {
+            __m512i y = _mm512_set1_epi64(static_cast<long long>(b[j]));
+            __m512i x0 = _mm512_loadu_si512(a + padding + k - j);
+            __m512i x1 = _mm512_loadu_si512(a + padding + k + 8 - j);
+            lo0 = _mm512_madd52lo_epu64(lo0, x0, y);
+            hi0 = _mm512_madd52hi_epu64(hi0, x0, y);
+            lo1 = _mm512_madd52lo_epu64(lo1, x1, y);
+            hi1 = _mm512_madd52hi_epu64(hi1, x1, y);
+        }
+        _mm512_storeu_si512(lo + k, lo0);
+        _mm512_storeu_si512(hi + k, hi0);
+        _mm512_storeu_si512(lo + k + 8, lo1);
+        _mm512_storeu_si512(hi + k + 8, hi1);
+    }
+}
+}
+
+bool supported()
+{
+    static bool const result = []
+    {
+        unsigned eax, ebx, ecx, edx;
+        if (!x86_adx::supported() || __get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return false;
+        }
+        unsigned const osxsave = 1u << 27;
+        if ((ecx & osxsave) == 0)
+        {
+            return false;
+        }
+        // the operating system must save the opmask and all of the zmm registers
+        unsigned xcr0_low, xcr0_high;
+        __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+        unsigned const avx512_state = 0xe6;
+        if ((xcr0_low & avx512_state) != avx512_state || __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return false;
+        }
+        unsigned const avx512f = 1u << 16;
+        unsigned const avx512ifma = 1u << 21;
+        return (ebx & avx512f) != 0 && (ebx & avx512ifma) != 0;
+    }();
+    return result;
+}
+
+void mul_radix52(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch)
+{
+    size_t am = digit_count(an);
+    size_t bm = digit_count(bn);
+    size_t blocks = block_count(an, bn);
+    digit_t* ad = scratch;
+    digit_t* bd = ad + padding + am + padding;
+    std::fill(ad, ad + padding, 0);
+    std::fill(ad + padding + am, bd, 0);
+    to_digits(ad + padding, a, an);
+    to_digits(bd, b, bn);
+
+    digit_t* lo = bd + bm;
+    digit_t* hi = lo + 16 * blocks;
+    columns(lo, hi, ad, am, bd, bm, blocks);
+
+    // the high halves belong one column up; the carries are propagated
+    // through the columns while the digits are packed into r[0..an + bn)
+    double_limb_t carry = 0;
+    double_limb_t bits = 0;
+    unsigned count = 0;
+    for (size_t i = 0, k = 0; i != an + bn; ++k)
+    {
+        carry += lo[k];
+        if (k != 0)
+        {
+            carry += hi[k - 1];
+        }
+        bits |= static_cast<double_limb_t>(static_cast<digit_t>(carry) & digit_mask) << count;
+        carry >>= digit_bits;
+        count += digit_bits;
+        if (count >= limb_bits)
+        {
+            r[i++] = static_cast<limb_t>(bits);
+            bits >>= limb_bits;
+            count -= limb_bits;
+        }
+    }
+}
+
+#else
+
+bool supported()
+{
+    return false;
+}
+
+void mul_radix52(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t*)
+{
+    portable::mul_basecase(r, a, an, b, bn);
+}
+
+#endif
+}
+}
@@ -0,0 +1,1187 @@
+#include "big_integer_kernels.h"
+#include "big_integer_parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace kernels
+{
+namespace
+{
+// divides (hi:lo) by d, requires hi < d
+inline limb_t div_2by1(limb_t hi, limb_t lo, limb_t d, limb_t& rem)
+{
+#if defined(__x86_64__)
+    limb_t q;
+    asm("divq %4" : "=a"(q), "=d"(rem) : "0"(lo), "1"(hi), "rm"(d));
+    return q;
+#else
+    double_limb_t n = (static_cast<double_limb_t>(hi) << limb_bits) | lo;
+    rem = static_cast<limb_t>(n % d);
+    return static_cast<limb_t>(n / d);
+#endif
+}
+
+inline unsigned count_leading_zeros(limb_t x)
+{
+    return static_cast<unsigned>(__builtin_clzll(x));
+}
+}
+
+size_t normalized_size(limb_t const* a, size_t n)
+{
+    while (n != 0 && a[n - 1] == 0)
+    {
+        --n;
+    }
+    return n;
+}
+
+int cmp(limb_t const* a, limb_t const* b, size_t n)
+{
+    while (n-- != 0)
+    {
+        if (a[n] != b[n])
+        {
+            return a[n] < b[n] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+int cmp(limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    if (an != bn)
+    {
+        return an < bn ? -1 : 1;
+    }
+    return cmp(a, b, an);
+}
+
+namespace portable
+{
+limb_t add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    limb_t carry = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        limb_t s = a[i] + carry;
+        carry = s < carry;
+        limb_t t = s + b[i];
+        carry += t < s;
+        r[i] = t;
+    }
+    return carry;
+}
+
+limb_t sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    limb_t borrow = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        limb_t x = a[i];
+        limb_t s = b[i] + borrow;
+        borrow = (s < borrow) | (x < s);
+        r[i] = x - s;
+    }
+    return borrow;
+}
+
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    limb_t carry = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        double_limb_t p = static_cast<double_limb_t>(a[i]) * b + carry;
+        r[i] = static_cast<limb_t>(p);
+        carry = static_cast<limb_t>(p >> limb_bits);
+    }
+    return carry;
+}
+
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    limb_t carry = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        double_limb_t p = static_cast<double_limb_t>(a[i]) * b + r[i] + carry;
+        r[i] = static_cast<limb_t>(p);
+        carry = static_cast<limb_t>(p >> limb_bits);
+    }
+    return carry;
+}
+
+void mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    r[an] = mul_1(r, a, an, b[0]);
+    for (size_t i = 1; i != bn; ++i)
+    {
+        r[an + i] = addmul_1(r + i, a, an, b[i]);
+    }
+}
+}
+
+namespace
+{
+bool always()
+{
+    return true;
+}
+
+implementation const* resolve();
+
+limb_t resolve_add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    return resolve()->add_n(r, a, b, n);
+}
+
+limb_t resolve_sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    return resolve()->sub_n(r, a, b, n);
+}
+
+limb_t resolve_mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    return resolve()->mul_1(r, a, n, b);
+}
+
+limb_t resolve_addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    return resolve()->addmul_1(r, a, n, b);
+}
+
+void resolve_mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    resolve()->mul_basecase(r, a, an, b, bn);
+}
+
+// the entries resolve the implementation on their first call and then
+// forward to it; this and the implementations are constant-initialized, so
+// kernels may run during the dynamic initialization of other files
+implementation const unresolved = {
+    "unresolved", always, resolve_add_n, resolve_sub_n, resolve_mul_1, resolve_addmul_1, resolve_mul_basecase,
+    nullptr};
+
+std::atomic<implementation const*> active(&unresolved);
+
+implementation const* find(char const* name)
+{
+    for (size_t i = 0; i != implementation_count; ++i)
+    {
+        if (std::strcmp(implementations[i].name, name) == 0)
+        {
+            return &implementations[i];
+        }
+    }
+    return nullptr;
+}
+
+implementation const* resolve()
+{
+    implementation const* chosen = &implementations[0];
+    for (size_t i = 1; i != implementation_count; ++i)
+    {
+        if (implementations[i].supported())
+        {
+            chosen = &implementations[i];
+        }
+    }
+    char const* forced = std::getenv("BIG_INTEGER_KERNELS");
+    if (forced != nullptr && *forced != '\0')
+    {
+        implementation const* named = find(forced);
+        if (named != nullptr && named->supported())
+        {
+            chosen = named;
+        }
+    }
+    // a concurrent first call or select_implementation may have won already
+    implementation const* expected = &unresolved;
+    active.compare_exchange_strong(expected, chosen);
+    return active.load();
+}
+}
+
+implementation const implementations[] = {
+    {"portable", always, portable::add_n, portable::sub_n, portable::mul_1, portable::addmul_1,
+     portable::mul_basecase, nullptr},
+    {"x86_adx", x86_adx::supported, x86_adx::add_n, x86_adx::sub_n, x86_adx::mul_1, x86_adx::addmul_1,
+     x86_adx::mul_basecase, nullptr},
+    {"x86_ifma", x86_ifma::supported, x86_adx::add_n, x86_adx::sub_n, x86_adx::mul_1, x86_adx::addmul_1,
+     x86_adx::mul_basecase, x86_ifma::mul_radix52},
+};
+
+size_t const implementation_count = sizeof(implementations) / sizeof(implementations[0]);
+
+implementation const& active_implementation()
+{
+    implementation const* current = active.load();
+    return current != &unresolved ? *current : *resolve();
+}
+
+bool select_implementation(char const* name)
+{
+    implementation const* named = find(name);
+    if (named == nullptr || !named->supported())
+    {
+        return false;
+    }
+    active.store(named);
+    return true;
+}
+
+limb_t add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    return active.load(std::memory_order_relaxed)->add_n(r, a, b, n);
+}
+
+limb_t add_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    size_t i = 0;
+    for (; i != n && b != 0; ++i)
+    {
+        limb_t s = a[i] + b;
+        b = s < b;
+        r[i] = s;
+    }
+    if (r != a)
+    {
+        for (; i != n; ++i)
+        {
+            r[i] = a[i];
+        }
+    }
+    return b;
+}
+
+limb_t add(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    limb_t carry = add_n(r, a, b, bn);
+    return add_1(r + bn, a + bn, an - bn, carry);
+}
+
+limb_t sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    return active.load(std::memory_order_relaxed)->sub_n(r, a, b, n);
+}
+
+limb_t sub_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    size_t i = 0;
+    for (; i != n && b != 0; ++i)
+    {
+        limb_t x = a[i];
+        r[i] = x - b;
+        b = x < b;
+    }
+    if (r != a)
+    {
+        for (; i != n; ++i)
+        {
+            r[i] = a[i];
+        }
+    }
+    return b;
+}
+
+limb_t sub(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    limb_t borrow = sub_n(r, a, b, bn);
+    return sub_1(r + bn, a + bn, an - bn, borrow);
+}
+
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    return active.load(std::memory_order_relaxed)->mul_1(r, a, n, b);
+}
+
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    return active.load(std::memory_order_relaxed)->addmul_1(r, a, n, b);
+}
+
+limb_t submul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    limb_t borrow = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        double_limb_t p = static_cast<double_limb_t>(a[i]) * b + borrow;
+        limb_t lo = static_cast<limb_t>(p);
+        borrow = static_cast<limb_t>(p >> limb_bits);
+        limb_t x = r[i];
+        r[i] = x - lo;
+        borrow += x < lo;
+    }
+    return borrow;
+}
+
+void mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    active.load(std::memory_order_relaxed)->mul_basecase(r, a, an, b, bn);
+}
+
+#ifndef BIG_INTEGER_KARATSUBA_THRESHOLD
+#define BIG_INTEGER_KARATSUBA_THRESHOLD 40
+#endif
+
+#ifndef BIG_INTEGER_TOOM3_THRESHOLD
+#define BIG_INTEGER_TOOM3_THRESHOLD 256
+#endif
+
+size_t karatsuba_threshold = BIG_INTEGER_KARATSUBA_THRESHOLD;
+size_t toom3_threshold = BIG_INTEGER_TOOM3_THRESHOLD;
+
+namespace
+{
+// r[0..xn) = |x - y|, xn >= yn; returns whether x < y
+bool abs_sub(limb_t* r, limb_t const* x, size_t xn, limb_t const* y, size_t yn)
+{
+    bool less = normalized_size(x + yn, xn - yn) == 0 && cmp(x, y, yn) < 0;
+    if (less)
+    {
+        sub_n(r, y, x, yn);
+        std::fill(r + yn, r + xn, 0);
+    }
+    else
+    {
+        sub(r, x, xn, y, yn);
+    }
+    return less;
+}
+
+// mul() with the scratch space for its recursion passed down instead of
+// allocated: scratch holds at least mul_scratch_size(an, bn) limbs
+void mul(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch);
+
+// r[0..an + bn) = a * b for operands of any order, possibly with leading zeros;
+// without scratch the product finds its own
+void mul_any(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch = nullptr)
+{
+    size_t rn = an + bn;
+    an = normalized_size(a, an);
+    bn = normalized_size(b, bn);
+    if (an < bn)
+    {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    if (bn == 0)
+    {
+        std::fill(r, r + rn, 0);
+        return;
+    }
+    if (scratch != nullptr)
+    {
+        mul(r, a, an, b, bn, scratch);
+    }
+    else
+    {
+        kernels::mul(r, a, an, b, bn);
+    }
+    std::fill(r + an + bn, r + rn, 0);
+}
+
+struct product
+{
+    limb_t* r;
+    limb_t const* a;
+    size_t an;
+    limb_t const* b;
+    size_t bn;
+};
+
+// mul_any for each of the products, one after the other in the same scratch
+// space, or side by side, each with its own, for operands of n limbs from
+// parallel_threshold on
+void mul_all(product const* products, size_t count, size_t n, limb_t* scratch)
+{
+    if (n < parallel_threshold || thread_count() == 1)
+    {
+        for (size_t i = 0; i != count; ++i)
+        {
+            product const& p = products[i];
+            mul_any(p.r, p.a, p.an, p.b, p.bn, scratch);
+        }
+        return;
+    }
+    parallel_for(count, 1, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i != end; ++i)
+        {
+            product const& p = products[i];
+            mul_any(p.r, p.a, p.an, p.b, p.bn);
+        }
+    });
+}
+
+// the routines below treat an n-limb buffer as a two's complement number
+void negate(limb_t* r, size_t n)
+{
+    for (size_t i = 0; i != n; ++i)
+    {
+        r[i] = ~r[i];
+    }
+    add_1(r, r, n, 1);
+}
+
+void halve(limb_t* r, size_t n)
+{
+    limb_t sign = r[n - 1] & (limb_t(1) << (limb_bits - 1));
+    rshift(r, r, n, 1);
+    r[n - 1] |= sign;
+}
+
+// exact division by 3 modulo B^n (Hensel division)
+void divexact_by3(limb_t* r, size_t n)
+{
+    limb_t const inverse = 0xaaaaaaaaaaaaaaabull;
+    limb_t carry = 0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        limb_t s = r[i];
+        limb_t l = s - carry;
+        carry = s < carry;
+        limb_t q = l * inverse;
+        r[i] = q;
+        carry += static_cast<limb_t>((static_cast<double_limb_t>(q) * 3) >> limb_bits);
+    }
+}
+
+// an > bn >= 1 and bn <= ceil(an / 2): multiply a by b in bn-limb slices;
+// scratch holds 2 bn limbs and the scratch of the slices
+void mul_unbalanced(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch)
+{
+    limb_t* t = scratch;
+    mul(r, a, bn, b, bn, t + 2 * bn);
+    std::fill(r + 2 * bn, r + an + bn, 0);
+    for (size_t i = bn; i < an; i += bn)
+    {
+        size_t len = std::min(bn, an - i);
+        mul(t, b, bn, a + i, len, t + 2 * bn);
+        add_n(r + i, r + i, t, len + bn);
+    }
+}
+
+// ceil(an / 2) < bn <= an; scratch holds 6 m + 1 limbs and the scratch of
+// the half products
+void mul_karatsuba(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch)
+{
+    size_t m = (an + 1) / 2;
+    size_t a1n = an - m;
+    size_t b1n = bn - m;
+    size_t rn = an + bn;
+
+    limb_t* da = scratch;
+    limb_t* db = da + m;
+    limb_t* z1 = db + m;
+    limb_t* t = z1 + 2 * m;
+
+    bool a_less = abs_sub(da, a, m, a + m, a1n);
+    bool b_less = abs_sub(db, b, m, b + m, b1n);
+    product const products[] = {{z1, da, m, db, m}, {r, a, m, b, m}, {r + 2 * m, a + m, a1n, b + m, b1n}};
+    mul_all(products, 3, bn, t + 2 * m + 1);
+
+    // a0 * b1 + a1 * b0 = z0 + z2 - (a0 - a1) * (b0 - b1)
+    t[2 * m] = add(t, r, 2 * m, r + 2 * m, a1n + b1n);
+    if (a_less == b_less)
+    {
+        sub(t, t, 2 * m + 1, z1, 2 * m);
+    }
+    else
+    {
+        add(t, t, 2 * m + 1, z1, 2 * m);
+    }
+    add(r + m, r + m, rn - m, t, std::min(2 * m + 1, rn - m));
+}
+
+// x(1), |x(-1)| and x(2) for x = x0 + x1 B^k + x2 B^2k, k + 1 limbs each;
+// returns whether x(-1) is negative
+bool toom3_evaluate(limb_t* p1, limb_t* m1, limb_t* p2, limb_t const* x, size_t k, size_t x2n)
+{
+    limb_t const* x0 = x;
+    limb_t const* x1 = x + k;
+    limb_t const* x2 = x + 2 * k;
+
+    p1[k] = add(p1, x0, k, x2, x2n);
+    bool negative = abs_sub(m1, p1, k + 1, x1, k);
+    add(p1, p1, k + 1, x1, k);
+
+    std::fill(p2, p2 + k + 1, 0);
+    p2[x2n] = lshift(p2, x2, x2n, 1);
+    add(p2, p2, k + 1, x1, k);
+    lshift(p2, p2, k + 1, 1);
+    add(p2, p2, k + 1, x0, k);
+    return negative;
+}
+
+// bn > 2 * ceil(an / 3), evaluates at 0, 1, -1, 2 and infinity; scratch
+// holds 6 (k + 1) + 7 n limbs and the scratch of the point products
+void mul_toom3(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch)
+{
+    size_t k = (an + 2) / 3;
+    size_t a2n = an - 2 * k;
+    size_t b2n = bn - 2 * k;
+    size_t infn = a2n + b2n;
+    size_t rn = an + bn;
+    size_t n = 2 * k + 2;
+
+    limb_t* ap1 = scratch;
+    limb_t* am1 = ap1 + (k + 1);
+    limb_t* ap2 = am1 + (k + 1);
+    limb_t* bp1 = ap2 + (k + 1);
+    limb_t* bm1 = bp1 + (k + 1);
+    limb_t* bp2 = bm1 + (k + 1);
+    limb_t* v1 = bp2 + (k + 1);
+    limb_t* vm1 = v1 + n;
+    limb_t* v2 = vm1 + n;
+    limb_t* c2 = v2 + n;
+    limb_t* d = c2 + n;
+    limb_t* u = d + n;
+    limb_t* t = u + n;
+
+    bool a_negative = toom3_evaluate(ap1, am1, ap2, a, k, a2n);
+    bool b_negative = toom3_evaluate(bp1, bm1, bp2, b, k, b2n);
+    product const products[] = {{v1, ap1, k + 1, bp1, k + 1},
+                                {vm1, am1, k + 1, bm1, k + 1},
+                                {v2, ap2, k + 1, bp2, k + 1},
+                                {r, a, k, b, k},
+                                {r + 4 * k, a + 2 * k, a2n, b + 2 * k, b2n}};
+    mul_all(products, 5, bn, t + n);
+    if (a_negative != b_negative)
+    {
+        negate(vm1, n);
+    }
+    limb_t const* v0 = r;
+    limb_t const* vinf = r + 4 * k;
+
+    // c2 = (v1 + vm1) / 2 - v0 - vinf
+    add_n(c2, v1, vm1, n);
+    halve(c2, n);
+    sub(c2, c2, n, v0, 2 * k);
+    sub(c2, c2, n, vinf, infn);
+
+    // d = c1 + c3 = (v1 - vm1) / 2
+    sub_n(d, v1, vm1, n);
+    halve(d, n);
+
+    // u = c1 + 4 c3 = (v2 - v0 - 4 c2 - 16 vinf) / 2
+    sub(u, v2, n, v0, 2 * k);
+    lshift(t, c2, n, 2);
+    sub_n(u, u, t, n);
+    std::fill(t, t + n, 0);
+    t[infn] = lshift(t, vinf, infn, 4);
+    sub_n(u, u, t, n);
+    halve(u, n);
+
+    // c3 = (u - d) / 3, c1 = d - c3
+    limb_t* c3 = u;
+    limb_t* c1 = d;
+    sub_n(c3, u, d, n);
+    divexact_by3(c3, n);
+    sub_n(c1, d, c3, n);
+
+    std::fill(r + 2 * k, r + 4 * k, 0);
+    add(r + k, r + k, rn - k, c1, std::min(n, rn - k));
+    add(r + 2 * k, r + 2 * k, rn - 2 * k, c2, std::min(n, rn - 2 * k));
+    add(r + 3 * k, r + 3 * k, rn - 3 * k, c3, std::min(n, rn - 3 * k));
+}
+
+bool use_radix52(size_t bn)
+{
+    return active_implementation().mul_radix52 != nullptr && bn >= ifma_threshold
+           && bn < std::min(ifma_karatsuba_threshold, max_radix52_limbs);
+}
+
+#if BIG_INTEGER_TESTING
+thread_local size_t recursive_product_count = 0;
+#endif
+
+void mul(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch)
+{
+    if (use_radix52(bn))
+    {
+        active_implementation().mul_radix52(r, a, an, b, bn, scratch);
+        return;
+    }
+    if (bn < std::max<size_t>(karatsuba_threshold, 2))
+    {
+        mul_basecase(r, a, an, b, bn);
+        return;
+    }
+#if BIG_INTEGER_TESTING
+    ++recursive_product_count;
+#endif
+    if (bn >= fft_threshold)
+    {
+        mul_fft(r, a, an, b, bn);
+    }
+    else if (bn <= (an + 1) / 2)
+    {
+        mul_unbalanced(r, a, an, b, bn, scratch);
+    }
+    else if (bn < toom3_threshold || bn <= 2 * ((an + 2) / 3))
+    {
+        mul_karatsuba(r, a, an, b, bn, scratch);
+    }
+    else
+    {
+        mul_toom3(r, a, an, b, bn, scratch);
+    }
+}
+
+// A bound on the scratch of the recursion on operands of at most n limbs: a
+// level takes at most 3 n + 4 limbs below Toom-3 and 20 (ceil(n / 3) + 1) <=
+// 7 n + 34 from there, and passes operands of at most ceil(n / 2) limbs, or
+// ceil(n / 3) + 1 in Toom-3, to the next. Unbalanced products take 2 bn
+// <= n + 1 limbs and pass their bn-limb slices on. A radix 2^52 product may
+// end the recursion at any level from ifma_threshold limbs, so its scratch is
+// counted at each.
+size_t scratch_bound(size_t n)
+{
+    bool radix52 = active_implementation().mul_radix52 != nullptr;
+    size_t size = 0;
+    for (;;)
+    {
+        if (radix52 && n >= ifma_threshold)
+        {
+            size += radix52_scratch_size(n, n);
+        }
+        if (n < std::max<size_t>(karatsuba_threshold, 2))
+        {
+            return size;
+        }
+        size += n >= toom3_threshold ? 7 * n + 34 : 3 * n + 4;
+        n = std::max((n + 1) / 2, n >= 3 ? (n + 2) / 3 + 1 : 1);
+    }
+}
+
+size_t mul_scratch_size(size_t an, size_t bn)
+{
+    if (use_radix52(bn))
+    {
+        return radix52_scratch_size(an, bn);
+    }
+    if (bn < std::max<size_t>(karatsuba_threshold, 2) || bn >= fft_threshold)
+    {
+        return 0;
+    }
+    return bn <= (an + 1) / 2 ? 2 * bn + scratch_bound(bn) : scratch_bound(an);
+}
+
+// Scratch space for products too large for the stack, kept by each thread
+// for its next product up to max_cached_scratch limbs. A product started
+// while the buffer is in use, by a thread that helps out in fork_join while
+// it waits, allocates its own.
+size_t const local_scratch = 2048;
+size_t const max_cached_scratch = size_t(1) << 16;
+
+struct scratch_cache
+{
+    std::vector<limb_t> limbs;
+    bool busy = false;
+};
+
+thread_local scratch_cache cache;
+
+struct scratch_lease
+{
+    explicit scratch_lease(scratch_cache& c)
+        : c(c)
+    {
+        c.busy = true;
+    }
+
+    ~scratch_lease()
+    {
+        c.busy = false;
+    }
+
+    scratch_cache& c;
+};
+
+// the stack buffer lives in a frame of its own, so that the basecase and NTT
+// products, which need no scratch, do not reserve and probe it
+template<typename F>
+__attribute__((noinline)) void with_local_scratch(F& f)
+{
+    limb_t local[local_scratch];
+    f(local);
+}
+
+// f(scratch) with at least size limbs of scratch, or with null if size is 0
+template<typename F>
+void with_scratch(size_t size, F f)
+{
+    if (size == 0)
+    {
+        f(nullptr);
+        return;
+    }
+    if (size <= local_scratch)
+    {
+        with_local_scratch(f);
+        return;
+    }
+    scratch_cache& c = cache;
+    if (c.busy || size > max_cached_scratch)
+    {
+        std::vector<limb_t> scratch(size);
+        f(scratch.data());
+        return;
+    }
+    if (c.limbs.size() < size)
+    {
+        c.limbs.resize(size);
+    }
+    scratch_lease lease(c);
+    f(c.limbs.data());
+}
+
+// products by a few limbs are accumulated row by row, with no room for the
+// product; from there on, mul_basecase into scratch and one add beat rows of
+// addmul_1
+size_t const max_row_limbs = 8;
+
+bool use_rows(size_t bn)
+{
+    return bn < max_row_limbs && !use_radix52(bn);
+}
+}
+
+void mul(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    with_scratch(mul_scratch_size(an, bn), [&](limb_t* scratch) { mul(r, a, an, b, bn, scratch); });
+}
+
+#if BIG_INTEGER_TESTING
+size_t recursive_products()
+{
+    return recursive_product_count;
+}
+#endif
+
+limb_t addmul(limb_t* r, size_t rn, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    limb_t carry = 0;
+    if (use_rows(bn))
+    {
+        for (size_t i = 0; i != bn; ++i)
+        {
+            limb_t high = addmul_1(r + i, a, an, b[i]);
+            carry += add_1(r + i + an, r + i + an, rn - i - an, high);
+        }
+        return carry;
+    }
+    with_scratch(an + bn + mul_scratch_size(an, bn), [&](limb_t* product) {
+        mul(product, a, an, b, bn, product + an + bn);
+        carry = add(r, r, rn, product, an + bn);
+    });
+    return carry;
+}
+
+bool submul(limb_t* r, size_t rn, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    limb_t borrow = 0;
+    if (use_rows(bn))
+    {
+        for (size_t i = 0; i != bn; ++i)
+        {
+            limb_t high = submul_1(r + i, a, an, b[i]);
+            borrow += sub_1(r + i + an, r + i + an, rn - i - an, high);
+        }
+    }
+    else
+    {
+        with_scratch(an + bn + mul_scratch_size(an, bn), [&](limb_t* product) {
+            mul(product, a, an, b, bn, product + an + bn);
+            borrow = sub(r, r, rn, product, an + bn);
+        });
+    }
+    if (borrow == 0)
+    {
+        return false;
+    }
+    negate(r, rn);
+    return true;
+}
+
+limb_t lshift(limb_t* r, limb_t const* a, size_t n, unsigned shift)
+{
+    unsigned back = limb_bits - shift;
+    limb_t out = a[n - 1] >> back;
+    for (size_t i = n - 1; i != 0; --i)
+    {
+        r[i] = (a[i] << shift) | (a[i - 1] >> back);
+    }
+    r[0] = a[0] << shift;
+    return out;
+}
+
+limb_t rshift(limb_t* r, limb_t const* a, size_t n, unsigned shift)
+{
+    unsigned back = limb_bits - shift;
+    limb_t out = a[0] << back;
+    for (size_t i = 0; i != n - 1; ++i)
+    {
+        r[i] = (a[i] >> shift) | (a[i + 1] << back);
+    }
+    r[n - 1] = a[n - 1] >> shift;
+    return out;
+}
+
+limb_t divrem_1(limb_t* q, limb_t const* a, size_t n, limb_t d)
+{
+    limb_t rem = 0;
+    for (size_t i = n; i-- != 0;)
+    {
+        q[i] = div_2by1(rem, a[i], d, rem);
+    }
+    return rem;
+}
+
+#ifndef BIG_INTEGER_DC_DIV_THRESHOLD
+#define BIG_INTEGER_DC_DIV_THRESHOLD 64
+#endif
+
+#ifndef BIG_INTEGER_NEWTON_DIV_THRESHOLD
+#define BIG_INTEGER_NEWTON_DIV_THRESHOLD 65536
+#endif
+
+size_t dc_div_threshold = BIG_INTEGER_DC_DIV_THRESHOLD;
+size_t newton_div_threshold = BIG_INTEGER_NEWTON_DIV_THRESHOLD;
+
+namespace
+{
+// the divide and conquer step needs halves of at least two limbs, and the
+// reciprocal recursion needs n / 2 + 2 < n
+bool use_dc_div(size_t n)
+{
+    return n >= std::max<size_t>(dc_div_threshold, 4);
+}
+
+bool use_newton_div(size_t n)
+{
+    return n >= std::max<size_t>(newton_div_threshold, 8);
+}
+
+// Knuth, TAOCP vol. 2, 4.3.1, algorithm D for a normalized v, vn >= 2:
+// q[0..un - vn) and the returned high limb are u / v, u[0..vn) becomes u % v
+limb_t divrem_basecase(limb_t* q, limb_t* u, size_t un, limb_t const* v, size_t vn)
+{
+    limb_t high = cmp(u + un - vn, v, vn) >= 0;
+    if (high)
+    {
+        sub_n(u + un - vn, u + un - vn, v, vn);
+    }
+
+    limb_t top = v[vn - 1];
+    limb_t next = v[vn - 2];
+    for (size_t j = un - vn; j-- != 0;)
+    {
+        limb_t* uj = u + j;
+        limb_t qhat;
+        limb_t rhat;
+        bool rhat_overflow = false;
+        if (uj[vn] == top)
+        {
+            qhat = ~limb_t(0);
+            rhat = uj[vn - 1] + top;
+            rhat_overflow = rhat < top;
+        }
+        else
+        {
+            qhat = div_2by1(uj[vn], uj[vn - 1], top, rhat);
+        }
+        while (!rhat_overflow
+               && static_cast<double_limb_t>(qhat) * next
+                      > ((static_cast<double_limb_t>(rhat) << limb_bits) | uj[vn - 2]))
+        {
+            --qhat;
+            rhat += top;
+            rhat_overflow = rhat < top;
+        }
+
+        limb_t borrow = submul_1(uj, v, vn, qhat);
+        if (uj[vn] < borrow)
+        {
+            --qhat;
+            add_n(uj, uj, v, vn);
+        }
+        uj[vn] = 0;
+        q[j] = qhat;
+    }
+    return high;
+}
+
+// Burnikel and Ziegler, "Fast recursive division", in the form used by GMP:
+// w[0..2n) / v[0..n) for a normalized v, q[0..n) and the returned high limb
+// are the quotient and w[0..n) becomes the remainder; scratch holds n limbs
+limb_t divrem_dc(limb_t* q, limb_t* w, limb_t const* v, size_t n, limb_t* scratch)
+{
+    size_t lo = n / 2;
+    size_t hi = n - lo;
+
+    // estimate the high half of the quotient from the high half of v and
+    // correct it with the low half, which costs at most a few additions
+    limb_t high = use_dc_div(hi) ? divrem_dc(q + lo, w + 2 * lo, v + lo, hi, scratch)
+                                 : divrem_basecase(q + lo, w + 2 * lo, 2 * hi, v + lo, hi);
+    mul_any(scratch, q + lo, hi, v, lo);
+    limb_t borrow = sub_n(w + lo, w + lo, scratch, n);
+    if (high != 0)
+    {
+        borrow += sub_n(w + n, w + n, v, lo);
+    }
+    while (borrow != 0)
+    {
+        high -= sub_1(q + lo, q + lo, hi, 1);
+        borrow -= add_n(w + lo, w + lo, v, n);
+    }
+
+    limb_t low = use_dc_div(lo) ? divrem_dc(q, w + hi, v + hi, lo, scratch)
+                                : divrem_basecase(q, w + hi, 2 * lo, v + hi, lo);
+    mul_any(scratch, v, hi, q, lo);
+    borrow = sub_n(w, w, scratch, n);
+    if (low != 0)
+    {
+        borrow += sub_n(w + lo, w + lo, v, hi);
+    }
+    while (borrow != 0)
+    {
+        sub_1(q, q, lo, 1);
+        borrow -= add_n(w, w, v, n);
+    }
+    return high;
+}
+
+// w[0..n + k) / v[0..n) for a normalized v and w[k..n + k) < v, k < n:
+// q[0..k) is the quotient and w[0..n) becomes the remainder
+void divrem_partial(limb_t* q, limb_t* w, limb_t const* v, size_t n, size_t k, limb_t* scratch)
+{
+    if (!use_dc_div(k))
+    {
+        divrem_basecase(q, w, n + k, v, n);
+        return;
+    }
+
+    limb_t high = divrem_dc(q, w + n - k, v + n - k, k, scratch);
+    mul_any(scratch, q, k, v, n - k);
+    limb_t borrow = sub_n(w, w, scratch, n);
+    if (high != 0)
+    {
+        borrow += sub_n(w + k, w + k, v, n - k);
+    }
+    while (borrow != 0)
+    {
+        high -= sub_1(q, q, k, 1);
+        borrow -= add_n(w, w, v, n);
+    }
+}
+
+size_t divrem_scratch_size(size_t un, size_t vn);
+void divrem_normalized(limb_t* q, limb_t* u, size_t un, limb_t const* v, size_t vn, limb_t* scratch);
+
+// x[0..n + 1) = floor(B^2n / v) for a normalized v, B = 2^limb_bits; from
+// the Newton iteration the result may be smaller by a few units, never larger
+void reciprocal(limb_t* x, limb_t const* v, size_t n)
+{
+    if (!use_newton_div(n))
+    {
+        std::vector<limb_t> w(2 * n + 1 + divrem_scratch_size(2 * n + 1, n));
+        w[2 * n] = 1;
+        divrem_normalized(x, w.data(), 2 * n + 1, v, n, w.data() + 2 * n + 1);
+        return;
+    }
+
+    // with xh = floor(B^2h / vh) - 4 for the top h limbs vh of v,
+    // x0 = xh * B^(n - h) <= B^2n / v, and one step of x = x0 + x0 * f / B^2n,
+    // f = B^2n - v * x0, squares the relative error of x0 from below
+    size_t h = n / 2 + 2;
+    std::vector<limb_t> buffer(h + 1 + n + h + 1);
+    limb_t* xh = buffer.data();
+    limb_t* f = xh + h + 1;
+    reciprocal(xh, v + n - h, h);
+    sub_1(xh, xh, h + 1, 4);
+
+    // f / B^(n - h) = B^(n + h) - v * xh, where 0 <= v * xh <= B^(n + h);
+    // the small top limb of xh is multiplied separately, which keeps the
+    // product from crossing a power of two in length
+    mul_any(f, v, n, xh, h);
+    f[n + h] = addmul_1(f + h, v, n, xh[h]);
+    negate(f, n + h);
+    size_t fn = normalized_size(f, n + h);
+
+    std::fill(x, x + n + 1, 0);
+    std::copy(xh, xh + h + 1, x + n - h);
+    if (fn + 1 > h)
+    {
+        std::vector<limb_t> g(h + 1 + fn);
+        mul_any(g.data(), xh, h + 1, f, fn);
+        add(x, x, n + 1, g.data() + 2 * h, fn + 1 - h);
+    }
+}
+
+// w[0..2n) / v[0..n) for w[n..2n) < v, given x from reciprocal(x, v, n):
+// q[0..n) is the quotient and w[0..n) becomes the remainder; scratch holds
+// 2n + 1 limbs
+void divrem_newton(limb_t* q, limb_t* w, limb_t const* v, limb_t const* x, size_t n, limb_t* scratch)
+{
+    // the estimate is at most a few units too small; x[n] is 1 or 2
+    mul_any(scratch, x, n, w + n, n);
+    scratch[2 * n] = addmul_1(scratch + n, w + n, n, x[n]);
+    std::copy(scratch + n, scratch + 2 * n, q);
+    mul_any(scratch, q, n, v, n);
+    sub_n(w, w, scratch, 2 * n);
+    while (w[n] != 0 || cmp(w, v, n) >= 0)
+    {
+        w[n] -= sub_n(w, w, v, n);
+        add_1(q, q, n, 1);
+    }
+}
+
+bool use_newton_div(size_t un, size_t vn)
+{
+    return use_newton_div(vn) && un - vn >= vn;
+}
+
+// the scratch of divrem_normalized: the remainders of the recursive division
+// need vn limbs, the Newton steps 2 vn + 1 and the reciprocal vn + 1 more
+size_t divrem_scratch_size(size_t un, size_t vn)
+{
+    return !use_dc_div(vn) ? 0 : use_newton_div(un, vn) ? 3 * vn + 2 : vn;
+}
+
+// u[0..un) / v[0..vn) for a normalized v and u[un - vn..un) < v:
+// q[0..un - vn) is the quotient and u[0..vn) becomes the remainder; scratch
+// holds divrem_scratch_size(un, vn) limbs
+void divrem_normalized(limb_t* q, limb_t* u, size_t un, limb_t const* v, size_t vn, limb_t* scratch)
+{
+    if (!use_dc_div(vn))
+    {
+        divrem_basecase(q, u, un, v, vn);
+        return;
+    }
+
+    // the quotient is produced from the top in blocks of vn limbs, after a
+    // shorter first block if the quotient length is not a multiple of vn
+    size_t qn = un - vn;
+    bool newton = use_newton_div(un, vn);
+    limb_t* x = scratch + 2 * vn + 1;
+    if (newton)
+    {
+        reciprocal(x, v, vn);
+    }
+
+    size_t j = qn - qn % vn;
+    if (j != qn)
+    {
+        divrem_partial(q + j, u + j, v, vn, qn - j, scratch);
+    }
+    while (j != 0)
+    {
+        j -= vn;
+        if (newton)
+        {
+            divrem_newton(q + j, u + j, v, x, vn, scratch);
+        }
+        else
+        {
+            divrem_dc(q + j, u + j, v, vn, scratch);
+        }
+    }
+}
+}
+
+void divrem(limb_t* q, limb_t* r, limb_t const* a, size_t an, limb_t const* d, size_t dn)
+{
+    // a quotient the caller does not want, normalized copies of both operands
+    // and the scratch of the division, in one buffer, on the stack when they
+    // are small
+    size_t qn = q == nullptr ? an - dn + 1 : 0;
+    size_t size = qn + (dn == 1 ? 0 : an + 1 + dn + divrem_scratch_size(an + 1, dn));
+    limb_t local[64];
+    std::vector<limb_t> heap;
+    limb_t* u = local;
+    if (size > sizeof(local) / sizeof(local[0]))
+    {
+        heap.resize(size);
+        u = heap.data();
+    }
+    if (q == nullptr)
+    {
+        q = u;
+        u += qn;
+    }
+
+    if (dn == 1)
+    {
+        limb_t remainder = divrem_1(q, a, an, d[0]);
+        if (r != nullptr)
+        {
+            r[0] = remainder;
+        }
+        return;
+    }
+    limb_t* v = u + an + 1;
+
+    unsigned shift = count_leading_zeros(d[dn - 1]);
+    if (shift != 0)
+    {
+        u[an] = lshift(u, a, an, shift);
+        lshift(v, d, dn, shift);
+    }
+    else
+    {
+        std::copy(a, a + an, u);
+        u[an] = 0;
+        std::copy(d, d + dn, v);
+    }
+
+    divrem_normalized(q, u, an + 1, v, dn, v + dn);
+
+    if (r == nullptr)
+    {
+        return;
+    }
+    if (shift != 0)
+    {
+        rshift(r, u, dn, shift);
+    }
+    else
+    {
+        std::copy(u, u + dn, r);
+    }
+}
+
+limb_t inverse_limb(limb_t m)
+{
+    // Newton's iteration doubles the correct low bits, m * m = 1 mod 8
+    limb_t x = m;
+    for (int i = 0; i != 5; ++i)
+    {
+        x *= 2 - m * x;
+    }
+    return x;
+}
+
+void redc(limb_t* r, limb_t* t, limb_t const* m, size_t n, limb_t m_inverse)
+{
+    // each step clears t[i] and leaves the carry of the row in its place,
+    // to be added at t[i + n] in one pass at the end
+    for (size_t i = 0; i != n; ++i)
+    {
+        t[i] = addmul_1(t + i, m, n, t[i] * m_inverse);
+    }
+    limb_t carry = add_n(r, t + n, t, n);
+
+    // the sum is below 2m, and m is subtracted when it carried or the
+    // difference does not borrow; the choice is made without branching
+    limb_t borrow = sub_n(t + n, r, m, n);
+    limb_t mask = 0 - (carry | (borrow ^ 1));
+    for (size_t i = 0; i != n; ++i)
+    {
+        r[i] = (t[n + i] & mask) | (r[i] & ~mask);
+    }
+}
+}
@@ -0,0 +1,200 @@
+#ifndef BIG_INTEGER_KERNELS_H
+#define BIG_INTEGER_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// set by the test target only, for hooks that production builds leave out
+#ifndef BIG_INTEGER_TESTING
+#define BIG_INTEGER_TESTING 0
+#endif
+
+// Natural-number routines over little-endian limb arrays.
+// Unless stated otherwise the result may alias an operand at the same offset,
+// and lengths are passed explicitly, so callers own all the storage.
+namespace kernels
+{
+typedef uint64_t limb_t;
+__extension__ typedef unsigned __int128 double_limb_t;
+
+unsigned const limb_bits = 64;
+
+size_t normalized_size(limb_t const* a, size_t n);
+
+int cmp(limb_t const* a, limb_t const* b, size_t n);
+int cmp(limb_t const* a, size_t an, limb_t const* b, size_t bn);
+
+// an >= bn for add and sub, and a >= b for sub; the carry/borrow is returned
+limb_t add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+limb_t add_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+limb_t add(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+
+limb_t sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+limb_t sub_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+limb_t sub(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+
+// r = a * b, r[0..n) += a * b, r[0..n) -= a * b; the high limb is returned
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+limb_t submul_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+
+// r[0..an + bn) = a * b, an >= bn >= 1, r must not overlap the operands.
+// mul sizes the scratch space of its whole recursion up front and takes it
+// from the stack, or for larger products from a buffer the thread keeps.
+void mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+void mul(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+
+#if BIG_INTEGER_TESTING
+// The products and sub-products the calling thread has passed on from mul to
+// Karatsuba, Toom-3, the unbalanced split or the NTT, whose control flow
+// depends on the limbs; tests check with it that code meant to run on a fixed
+// schedule stays out of them.
+size_t recursive_products();
+#endif
+
+// r[0..rn) += a * b with the carry out of r returned, and r[0..rn) =
+// |r - a * b| with whether a * b > r returned; rn >= an + bn, an >= bn >= 1,
+// and r must not overlap the operands. Products by a few limbs are added row
+// by row, larger ones go through the scratch space of mul.
+limb_t addmul(limb_t* r, size_t rn, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+bool submul(limb_t* r, size_t rn, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+
+// The loops above come in a portable version and, for x86-64 processors with
+// BMI2 and ADX (Broadwell, Zen and later), in one using mulx with the adcx and
+// adox carry chains.
+namespace portable
+{
+limb_t add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+limb_t sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+void mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+}
+
+namespace x86_adx
+{
+bool supported();
+limb_t add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+limb_t sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b);
+void mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+}
+
+// Processors with AVX-512 IFMA (Ice Lake, Zen 4 and later) also multiply in
+// radix 2^52, eight digits at a time. mul_radix52 has the contract of
+// mul_basecase, for bn < max_radix52_limbs, and works in scratch of
+// radix52_scratch_size(an, bn) limbs; on tiers that have it, mul uses it
+// from ifma_threshold limbs (BIG_INTEGER_IFMA_THRESHOLD) until Karatsuba takes
+// over at ifma_karatsuba_threshold (BIG_INTEGER_IFMA_KARATSUBA_THRESHOLD).
+extern size_t ifma_threshold;
+extern size_t ifma_karatsuba_threshold;
+size_t const max_radix52_limbs = 3328;
+size_t radix52_scratch_size(size_t an, size_t bn);
+
+namespace x86_ifma
+{
+bool supported();
+void mul_radix52(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch);
+}
+
+// The implementations compiled in, slowest first. The kernels above call
+// through a single table, set on their first call to the last implementation
+// the processor supports, or to the one named by the environment variable
+// BIG_INTEGER_KERNELS (portable, x86_adx, x86_ifma) if it is supported, so that
+// runs can be reproduced on any tier; other names are ignored, and
+// active_implementation().name tells which tier runs. select_implementation
+// switches tiers later, and fails for unknown or unsupported names; it must not
+// be called while another thread runs arithmetic, as a product sizes its
+// scratch for the tier it starts on. mul_radix52 is null for tiers without a
+// radix 2^52 product.
+struct implementation
+{
+    char const* name;
+    bool (*supported)();
+    limb_t (*add_n)(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+    limb_t (*sub_n)(limb_t* r, limb_t const* a, limb_t const* b, size_t n);
+    limb_t (*mul_1)(limb_t* r, limb_t const* a, size_t n, limb_t b);
+    limb_t (*addmul_1)(limb_t* r, limb_t const* a, size_t n, limb_t b);
+    void (*mul_basecase)(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+    void (*mul_radix52)(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn, limb_t* scratch);
+};
+
+extern implementation const implementations[];
+extern size_t const implementation_count;
+
+implementation const& active_implementation();
+bool select_implementation(char const* name);
+
+// Smallest operand sizes, in limbs, handled by Karatsuba and Toom-3.
+// The defaults come from BIG_INTEGER_KARATSUBA_THRESHOLD and
+// BIG_INTEGER_TOOM3_THRESHOLD; they are variables so that the calibration
+// benchmark can sweep them.
+extern size_t karatsuba_threshold;
+extern size_t toom3_threshold;
+
+// Two-prime NTT multiplication, used from fft_threshold limbs
+// (BIG_INTEGER_FFT_THRESHOLD).
+extern size_t fft_threshold;
+void mul_fft(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+
+// Toom-3 and Karatsuba products of at least parallel_threshold limbs
+// (BIG_INTEGER_PARALLEL_THRESHOLD) compute their sub-products concurrently,
+// and so do the transforms of NTT products that size, on thread_count()
+// threads, one per hardware thread unless set_thread_count says otherwise.
+// The results do not depend on the number of threads. set_thread_count(1)
+// keeps every product on the calling thread; it must not be called while
+// another thread multiplies.
+extern size_t parallel_threshold;
+size_t thread_count();
+void set_thread_count(size_t threads);
+
+// 0 < shift < limb_bits, the bits shifted out are returned in the low (lshift)
+// or high (rshift) end of the result; r may also overlap a from above (lshift)
+// or from below (rshift)
+limb_t lshift(limb_t* r, limb_t const* a, size_t n, unsigned shift);
+limb_t rshift(limb_t* r, limb_t const* a, size_t n, unsigned shift);
+
+// Decimal conversion by divide and conquer. to_decimal writes the digits of
+// a[0..n), n >= 1, a[n - 1] != 0, most significant first and without leading
+// zeros, to out[0..20 n) and returns their count. from_decimal reads
+// length digits ('0'..'9', leading zeros allowed) into r[0..length / 19 + 1)
+// and returns the normalized size.
+size_t to_decimal(char* out, limb_t const* a, size_t n);
+size_t from_decimal(limb_t* r, char const* digits, size_t length);
+
+// q[0..n) = a / d, the remainder is returned
+limb_t divrem_1(limb_t* q, limb_t const* a, size_t n, limb_t d);
+
+// q[0..an - dn + 1) = a / d, r[0..dn) = a % d,
+// an >= dn >= 1, d[dn - 1] != 0, q and r must not overlap the operands; either
+// may be null when the caller does not want it, and is then not allocated
+//
+// Divisors of at least dc_div_threshold limbs (BIG_INTEGER_DC_DIV_THRESHOLD)
+// use Burnikel-Ziegler recursive division, and from newton_div_threshold
+// limbs (BIG_INTEGER_NEWTON_DIV_THRESHOLD) the quotient comes from a Newton
+// reciprocal of the divisor.
+extern size_t dc_div_threshold;
+extern size_t newton_div_threshold;
+void divrem(limb_t* q, limb_t* r, limb_t const* a, size_t an, limb_t const* d, size_t dn);
+
+// g[0..gn) = gcd(a, b) for an, bn >= 1 with a[an - 1], b[bn - 1] != 0, and
+// gn is returned; g needs min(an, bn) limbs. gcdext also finds s[0..*sn),
+// at most bn limbs, with s a = g (mod b) and |s| <= b / g, and its sign.
+// From hgcd_threshold limbs (BIG_INTEGER_HGCD_THRESHOLD) both reduce the
+// operands by the subquadratic half-gcd.
+extern size_t hgcd_threshold;
+size_t gcd(limb_t* g, limb_t const* a, size_t an, limb_t const* b, size_t bn);
+size_t gcdext(limb_t* g, limb_t* s, size_t* sn, bool* s_negative, limb_t const* a, size_t an, limb_t const* b,
+              size_t bn);
+
+// m^-1 mod 2^64 for odd m
+limb_t inverse_limb(limb_t m);
+
+// Montgomery reduction: r[0..n) = t / 2^(64 n) mod m for t[0..2n) < m 2^(64 n),
+// where m is odd, m[n - 1] != 0 and m_inverse = -m^-1 mod 2^64; t is
+// clobbered and r may be t. The running time depends only on n.
+void redc(limb_t* r, limb_t* t, limb_t const* m, size_t n, limb_t m_inverse);
+}
+
+#endif // BIG_INTEGER_KERNELS_H
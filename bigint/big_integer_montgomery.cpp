@@ -0,0 +1,287 @@
+#include "big_integer_montgomery.h"
+#include "big_integer_kernels.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+typedef kernels::limb_t limb_t;
+
+// the count bits of e[0..n) from bit low, which must all exist
+limb_t bit_field(limb_t const* e, size_t n, size_t low, size_t count)
+{
+    size_t i = low / kernels::limb_bits;
+    unsigned shift = low % kernels::limb_bits;
+    limb_t x = e[i] >> shift;
+    if (shift != 0 && i + 1 != n)
+    {
+        x |= e[i + 1] << (kernels::limb_bits - shift);
+    }
+    return count == kernels::limb_bits ? x : x & ((limb_t(1) << count) - 1);
+}
+
+size_t bit_length(limb_t const* e, size_t n)
+{
+    return n == 0 ? 0 : n * kernels::limb_bits - static_cast<size_t>(__builtin_clzll(e[n - 1]));
+}
+
+// sliding window width for an exponent of the given length, from the
+// cost of the table against the multiplications it saves
+size_t window_bits(size_t bits)
+{
+    return bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : 1;
+}
+
+// fixed windows of powmod_ct, which divide the limb size
+size_t const ct_window_bits = 4;
+}
+
+montgomery_context::montgomery_context(big_integer const& modulus)
+    : m(modulus)
+    , m_inverse(0)
+{
+    if (m.negative || m.limbs.empty() || (m.limbs[0] & 1) == 0)
+    {
+        throw std::runtime_error("invalid modulus");
+    }
+    m_inverse = 0 - kernels::inverse_limb(m.limbs[0]);
+    r2 = (big_integer(1) << static_cast<int>(2 * kernels::limb_bits * m.limbs.size())) % m;
+}
+
+big_integer const& montgomery_context::modulus() const
+{
+    return m;
+}
+
+big_integer montgomery_context::to_montgomery(big_integer const& a) const
+{
+    if (!a.negative && a.compare_magnitude(m) < 0)
+    {
+        return mulmod(a, r2);
+    }
+    big_integer x = a % m;
+    if (x.negative)
+    {
+        x += m;
+    }
+    return mulmod(x, r2);
+}
+
+big_integer montgomery_context::from_montgomery(big_integer const& a) const
+{
+    big_integer t = a;
+    return reduce(std::move(t));
+}
+
+big_integer montgomery_context::mulmod(big_integer const& a, big_integer const& b) const
+{
+    big_integer const* x = &a;
+    big_integer const* y = &b;
+    if (x->limbs.size() < y->limbs.size())
+    {
+        std::swap(x, y);
+    }
+    big_integer t;
+    if (y->limbs.empty())
+    {
+        return t;
+    }
+    t.limbs.resize(2 * m.limbs.size());
+    kernels::mul(t.limbs.data(), x->limbs.data(), x->limbs.size(), y->limbs.data(), y->limbs.size());
+    return reduce(std::move(t));
+}
+
+big_integer montgomery_context::sqrmod(big_integer const& a) const
+{
+    return mulmod(a, a);
+}
+
+big_integer montgomery_context::reduce(big_integer&& t) const
+{
+    size_t n = m.limbs.size();
+    t.limbs.resize(2 * n);
+    kernels::redc(t.limbs.data(), t.limbs.data(), m.limbs.data(), n, m_inverse);
+    t.limbs.resize(n);
+    t.trim();
+    return std::move(t);
+}
+
+big_integer montgomery_context::powmod(big_integer const& a, big_integer const& e) const
+{
+    if (e.negative)
+    {
+        throw std::runtime_error("negative exponent");
+    }
+    size_t bits = bit_length(e.limbs.data(), e.limbs.size());
+    if (bits == 0)
+    {
+        return to_montgomery(1);
+    }
+
+    // the odd powers a, a^3, ..., a^(2^k - 1), a^2, the result and scratch
+    size_t n = m.limbs.size();
+    size_t k = window_bits(bits);
+    size_t entries = size_t(1) << (k - 1);
+    std::vector<limb_t> buffer((entries + 4) * n);
+    limb_t* table = buffer.data();
+    limb_t* square = table + entries * n;
+    limb_t* x = square + n;
+    limb_t* t = x + n;
+    copy_limbs(table, a);
+    mul_limbs(square, table, table, t);
+    for (size_t i = 1; i != entries; ++i)
+    {
+        mul_limbs(table + i * n, table + (i - 1) * n, square, t);
+    }
+
+    // each window e[low, i) has at most k bits and starts and ends with a one
+    bool started = false;
+    for (size_t i = bits; i != 0;)
+    {
+        if (bit_field(e.limbs.data(), e.limbs.size(), i - 1, 1) == 0)
+        {
+            mul_limbs(x, x, x, t);
+            --i;
+            continue;
+        }
+        size_t low = i > k ? i - k : 0;
+        while (bit_field(e.limbs.data(), e.limbs.size(), low, 1) == 0)
+        {
+            ++low;
+        }
+        limb_t const* power = table + (bit_field(e.limbs.data(), e.limbs.size(), low, i - low) >> 1) * n;
+        if (started)
+        {
+            for (size_t j = low; j != i; ++j)
+            {
+                mul_limbs(x, x, x, t);
+            }
+            mul_limbs(x, x, power, t);
+        }
+        else
+        {
+            std::copy(power, power + n, x);
+            started = true;
+        }
+        i = low;
+    }
+    return from_limbs(x);
+}
+
+big_integer montgomery_context::powmod_ct(big_integer const& a, big_integer const& e) const
+{
+    if (e.negative)
+    {
+        throw std::runtime_error("negative exponent");
+    }
+
+    // all powers a^0 .. a^(2^k - 1), the selected one, the result and scratch
+    size_t n = m.limbs.size();
+    size_t entries = size_t(1) << ct_window_bits;
+    std::vector<limb_t> buffer((entries + 4) * n);
+    limb_t* table = buffer.data();
+    limb_t* power = table + entries * n;
+    limb_t* x = power + n;
+    limb_t* t = x + n;
+    copy_limbs(table, to_montgomery(1));
+    copy_limbs(table + n, a);
+    for (size_t i = 2; i != entries; ++i)
+    {
+        mul_limbs_ct(table + i * n, table + (i - 1) * n, table + n, t);
+    }
+    std::copy(table, table + n, x);
+
+    // every window costs the same squarings and one multiplication, and the
+    // table is read in full with masks instead of at a secret index
+    for (size_t i = e.limbs.size() * kernels::limb_bits; i != 0;)
+    {
+        i -= ct_window_bits;
+        for (size_t j = 0; j != ct_window_bits; ++j)
+        {
+            mul_limbs_ct(x, x, x, t);
+        }
+        limb_t digit = bit_field(e.limbs.data(), e.limbs.size(), i, ct_window_bits);
+        std::fill(power, power + n, 0);
+        for (size_t j = 0; j != entries; ++j)
+        {
+            limb_t d = j ^ digit;
+            limb_t mask = ((d | (0 - d)) >> (kernels::limb_bits - 1)) - 1;
+            for (size_t l = 0; l != n; ++l)
+            {
+                power[l] |= table[j * n + l] & mask;
+            }
+        }
+        mul_limbs_ct(x, x, power, t);
+    }
+    return from_limbs(x);
+}
+
+void montgomery_context::mul_limbs(limb_t* r, limb_t const* a, limb_t const* b, limb_t* t) const
+{
+    size_t n = m.limbs.size();
+    kernels::mul(t, a, n, b, n);
+    kernels::redc(r, t, m.limbs.data(), n, m_inverse);
+}
+
+void montgomery_context::mul_limbs_ct(limb_t* r, limb_t const* a, limb_t const* b, limb_t* t) const
+{
+    size_t n = m.limbs.size();
+    kernels::mul_basecase(t, a, n, b, n);
+    kernels::redc(r, t, m.limbs.data(), n, m_inverse);
+}
+
+void montgomery_context::copy_limbs(limb_t* r, big_integer const& a) const
+{
+    std::fill(std::copy(a.limbs.begin(), a.limbs.end(), r), r + m.limbs.size(), 0);
+}
+
+big_integer montgomery_context::from_limbs(limb_t const* a) const
+{
+    big_integer r;
+    r.limbs.assign(a, a + m.limbs.size());
+    r.trim();
+    return r;
+}
+
+big_integer powmod(big_integer const& base, big_integer const& exponent, big_integer const& modulus)
+{
+    if (modulus <= 0)
+    {
+        throw std::runtime_error("invalid modulus");
+    }
+    if (modulus % 2 != 0)
+    {
+        montgomery_context ctx(modulus);
+        return ctx.from_montgomery(ctx.powmod(ctx.to_montgomery(base), exponent));
+    }
+    if (exponent < 0)
+    {
+        throw std::runtime_error("negative exponent");
+    }
+
+    // Montgomery form needs an odd modulus, even ones take divisions
+    big_integer r = 1;
+    big_integer b = base % modulus;
+    if (b < 0)
+    {
+        b += modulus;
+    }
+    for (big_integer e = exponent; e != 0; e >>= 1)
+    {
+        if (e % 2 != 0)
+        {
+            r = r * b % modulus;
+        }
+        b = b * b % modulus;
+    }
+    return r;
+}
+
+big_integer powmod_ct(big_integer const& base, big_integer const& exponent, big_integer const& modulus)
+{
+    montgomery_context ctx(modulus);
+    return ctx.from_montgomery(ctx.powmod_ct(ctx.to_montgomery(base), exponent));
+}
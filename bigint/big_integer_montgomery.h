@@ -0,0 +1,57 @@
+#ifndef BIG_INTEGER_MONTGOMERY_H
+#define BIG_INTEGER_MONTGOMERY_H
+
+#include "big_integer.h"
+#include "big_integer_storage.h"
+
+// Multiplication modulo a fixed odd m > 0 without division. Values are kept
+// in Montgomery form x R mod m, R = 2^(64 n) for an n-limb modulus, and the
+// operands of mulmod and sqrmod must be such values, that is in [0, m).
+struct montgomery_context
+{
+    // throws std::runtime_error unless the modulus is odd and positive
+    explicit montgomery_context(big_integer const& modulus);
+
+    big_integer const& modulus() const;
+
+    // a R mod m for any a, and a / R mod m for a in [0, m)
+    big_integer to_montgomery(big_integer const& a) const;
+    big_integer from_montgomery(big_integer const& a) const;
+
+    // a b / R mod m and a a / R mod m
+    big_integer mulmod(big_integer const& a, big_integer const& b) const;
+    big_integer sqrmod(big_integer const& a) const;
+
+    // a^e in Montgomery form for exponents e >= 0: powmod uses sliding
+    // windows, and the time powmod_ct takes depends only on the limb counts of
+    // e and m, not on the bits of e
+    big_integer powmod(big_integer const& a, big_integer const& e) const;
+    big_integer powmod_ct(big_integer const& a, big_integer const& e) const;
+
+private:
+    using limb_t = limb_storage::limb_t;
+
+    // r[0..n) = a b / R mod m on operands padded to n limbs, with t[0..2n)
+    // as scratch; r may be a or b. mul_limbs_ct takes the schoolbook product,
+    // whose loops do not depend on the limbs, rather than the fastest one.
+    void mul_limbs(limb_t* r, limb_t const* a, limb_t const* b, limb_t* t) const;
+    void mul_limbs_ct(limb_t* r, limb_t const* a, limb_t const* b, limb_t* t) const;
+    // a padded to n limbs
+    void copy_limbs(limb_t* r, big_integer const& a) const;
+    big_integer from_limbs(limb_t const* a) const;
+
+    // t / R mod m for 0 <= t < m R, reusing the storage of t
+    big_integer reduce(big_integer&& t) const;
+
+    big_integer m;
+    big_integer r2;
+    limb_t m_inverse;
+};
+
+// base^exponent mod modulus in [0, modulus) for exponent >= 0 and
+// modulus > 0; both throw std::runtime_error otherwise. powmod_ct needs an
+// odd modulus and keeps the bits of the exponent out of its running time.
+big_integer powmod(big_integer const& base, big_integer const& exponent, big_integer const& modulus);
+big_integer powmod_ct(big_integer const& base, big_integer const& exponent, big_integer const& modulus);
+
+#endif // BIG_INTEGER_MONTGOMERY_H
@@ -0,0 +1,289 @@
+#include "big_integer_kernels.h"
+#include "big_integer_parallel.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Multiplication by number-theoretic transforms modulo two 62-bit primes,
+// with the convolution of 32-bit digits recovered by the Chinese remainder
+// theorem. Field elements are kept in Montgomery form (R = 2^64).
+
+#ifndef BIG_INTEGER_FFT_THRESHOLD
+#define BIG_INTEGER_FFT_THRESHOLD 6656
+#endif
+
+namespace kernels
+{
+size_t fft_threshold = BIG_INTEGER_FFT_THRESHOLD;
+
+namespace
+{
+unsigned const digit_bits = 32;
+size_t const digits_per_limb = limb_bits / digit_bits;
+limb_t const digit_mask = 0xffffffffu;
+
+// butterfly(i + j, j) for the n / 2 butterflies of a transform stage, blocks
+// of 2 half elements with j in [0, half); from fft_grain butterflies the stage
+// is split between threads
+size_t const fft_grain = 8192;
+
+template<typename Butterfly>
+void stage(size_t n, size_t half, size_t grain, Butterfly butterfly)
+{
+    parallel_for(n / 2, grain, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b != end;)
+        {
+            size_t i = b / half * 2 * half;
+            size_t j = b % half;
+            size_t last = std::min(half, j + (end - b));
+            b += last - j;
+            for (; j != last; ++j)
+            {
+                butterfly(i + j, j);
+            }
+        }
+    });
+}
+
+// m^-1 mod 2^64 for odd m by Newton's iteration, x = m is correct to 3 bits
+constexpr limb_t inverse_mod_limb(limb_t m, limb_t x, int steps)
+{
+    return steps == 0 ? x : inverse_mod_limb(m, x * (2 - m * x), steps - 1);
+}
+
+template<limb_t Mod, limb_t Generator>
+struct prime_field
+{
+    static constexpr limb_t mod = Mod;
+    static constexpr limb_t neg_inverse = 0 - inverse_mod_limb(Mod, Mod, 5);
+
+    // t < Mod * R, the result is t / R mod Mod, in [0, 2 * Mod)
+    static limb_t reduce_lazy(double_limb_t t)
+    {
+        limb_t m = static_cast<limb_t>(t) * neg_inverse;
+        return static_cast<limb_t>((t + static_cast<double_limb_t>(m) * Mod) >> limb_bits);
+    }
+
+    static limb_t reduce(double_limb_t t)
+    {
+        return normalize(reduce_lazy(t));
+    }
+
+    // a * b / R for a * b < Mod * R, in [0, 2 * Mod)
+    static limb_t mul_lazy(limb_t a, limb_t b)
+    {
+        return reduce_lazy(static_cast<double_limb_t>(a) * b);
+    }
+
+    static limb_t mul(limb_t a, limb_t b)
+    {
+        return reduce(static_cast<double_limb_t>(a) * b);
+    }
+
+    // [0, 2 * Mod) to [0, Mod), and [0, 4 * Mod) to [0, 2 * Mod) for twice_normalize
+    static limb_t normalize(limb_t a)
+    {
+        return a >= Mod ? a - Mod : a;
+    }
+
+    static limb_t twice_normalize(limb_t a)
+    {
+        return a >= 2 * Mod ? a - 2 * Mod : a;
+    }
+
+    static limb_t sub(limb_t a, limb_t b)
+    {
+        return a >= b ? a - b : a + Mod - b;
+    }
+
+    static limb_t to_montgomery(limb_t a)
+    {
+        return static_cast<limb_t>((static_cast<double_limb_t>(a) << limb_bits) % Mod);
+    }
+
+    // a and the result are in Montgomery form
+    static limb_t pow(limb_t a, uint64_t e)
+    {
+        limb_t r = to_montgomery(1);
+        for (; e != 0; e >>= 1, a = mul(a, a))
+        {
+            if (e & 1)
+            {
+                r = mul(r, a);
+            }
+        }
+        return r;
+    }
+
+    static limb_t inverse(limb_t a)
+    {
+        return pow(a, Mod - 2);
+    }
+
+    // roots[half + j] = w^j where w is a primitive root of unity of order 2 * half
+    static void roots_of_unity(std::vector<limb_t>& roots, size_t n)
+    {
+        roots.resize(n);
+        for (size_t half = 1; half < n; half *= 2)
+        {
+            limb_t w = pow(to_montgomery(Generator), (Mod - 1) / (2 * half));
+            limb_t x = to_montgomery(1);
+            for (size_t j = 0; j != half; ++j)
+            {
+                roots[half + j] = x;
+                x = mul(x, w);
+            }
+        }
+    }
+
+    // the digits of a in Montgomery form: reducing digit * R^2 gives digit * R
+    static void split_digits(limb_t* f, size_t n, limb_t const* a, size_t an, size_t grain)
+    {
+        limb_t const r2 = to_montgomery(to_montgomery(1));
+        std::fill(f + an * digits_per_limb, f + n, 0);
+        parallel_for(an, grain, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i != end; ++i)
+            {
+                for (size_t j = 0; j != digits_per_limb; ++j)
+                {
+                    f[i * digits_per_limb + j] = mul_lazy((a[i] >> (j * digit_bits)) & digit_mask, r2);
+                }
+            }
+        });
+    }
+
+    // The transforms keep values in [0, 2 * Mod) and reduce them fully only at
+    // the end; Mod < 2^62 leaves room for the intermediate [0, 4 * Mod).
+
+    // decimation in frequency: natural order in, bit-reversed order out
+    static void forward_transform(limb_t* f, size_t n, limb_t const* roots, size_t grain)
+    {
+        for (size_t half = n / 2; half != 0; half /= 2)
+        {
+            limb_t const* w = roots + half;
+            stage(n, half, grain, [=](size_t i, size_t j) {
+                limb_t u = f[i];
+                limb_t v = f[i + half];
+                f[i] = twice_normalize(u + v);
+                f[i + half] = mul_lazy(u - v + 2 * Mod, w[j]);
+            });
+        }
+    }
+
+    // decimation in time: bit-reversed order in, natural order out; computes
+    // the inverse transform scaled by n with reversed f[1..n)
+    static void backward_transform(limb_t* f, size_t n, limb_t const* roots, size_t grain)
+    {
+        for (size_t half = 1; half < n; half *= 2)
+        {
+            limb_t const* w = roots + half;
+            stage(n, half, grain, [=](size_t i, size_t j) {
+                limb_t u = f[i];
+                limb_t v = mul_lazy(f[i + half], w[j]);
+                f[i] = twice_normalize(u + v);
+                f[i + half] = twice_normalize(u - v + 2 * Mod);
+            });
+        }
+    }
+
+    // multiplying by the plain 1 / n also takes the values out of Montgomery form
+    static void inverse_transform(limb_t* f, size_t n, limb_t const* roots, size_t grain)
+    {
+        backward_transform(f, n, roots, grain);
+        std::reverse(f + 1, f + n);
+        limb_t scale = reduce(inverse(to_montgomery(n)));
+        parallel_for(n, grain, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i != end; ++i)
+            {
+                f[i] = mul(f[i], scale);
+            }
+        });
+    }
+
+    // f[0..n) becomes the cyclic convolution of the digits of a and b; loops
+    // over at least grain elements are split between threads
+    static void convolve(limb_t* f, limb_t* g, size_t n,
+                         limb_t const* a, size_t an, limb_t const* b, size_t bn, size_t grain)
+    {
+        std::vector<limb_t> roots;
+        roots_of_unity(roots, n);
+        split_digits(f, n, a, an, grain);
+        forward_transform(f, n, roots.data(), grain);
+        if (a == b && an == bn)
+        {
+            parallel_for(n, grain, [=](size_t begin, size_t end) {
+                for (size_t i = begin; i != end; ++i)
+                {
+                    f[i] = mul_lazy(f[i], f[i]);
+                }
+            });
+        }
+        else
+        {
+            split_digits(g, n, b, bn, grain);
+            forward_transform(g, n, roots.data(), grain);
+            parallel_for(n, grain, [=](size_t begin, size_t end) {
+                for (size_t i = begin; i != end; ++i)
+                {
+                    f[i] = mul_lazy(f[i], g[i]);
+                }
+            });
+        }
+        inverse_transform(f, n, roots.data(), grain);
+    }
+};
+
+template<limb_t Mod, limb_t Generator>
+constexpr limb_t prime_field<Mod, Generator>::neg_inverse;
+
+// 29 * 2^57 + 1 and 69 * 2^55 + 1: the coefficients of the convolution stay
+// below n * 2^64 < p1 * p2 for every transform length the primes support
+typedef prime_field<4179340454199820289ull, 3> field1;
+typedef prime_field<2485986994308513793ull, 5> field2;
+}
+
+void mul_fft(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    size_t rn = an + bn;
+    size_t n = 1;
+    while (n < rn * digits_per_limb)
+    {
+        n *= 2;
+    }
+
+    // the two convolutions run side by side in parallel products
+    bool parallel = rn >= parallel_threshold && thread_count() != 1;
+    size_t grain = parallel ? fft_grain : SIZE_MAX;
+    std::vector<limb_t> buffer((parallel ? 4 : 3) * n);
+    limb_t* f1 = buffer.data();
+    limb_t* f2 = f1 + n;
+    limb_t* g1 = f2 + n;
+    limb_t* g2 = parallel ? g1 + n : g1;
+    std::function<void()> const convolutions[] = {
+        [=] { field1::convolve(f1, g1, n, a, an, b, bn, grain); },
+        [=] { field2::convolve(f2, g2, n, a, an, b, bn, grain); }};
+    if (parallel)
+    {
+        fork_join(convolutions, 2);
+    }
+    else
+    {
+        convolutions[0]();
+        convolutions[1]();
+    }
+
+    // Garner's algorithm: x = x1 + p1 * ((x2 - x1) / p1 mod p2), p2 < p1 < 2 * p2
+    limb_t const inv_p1 = field2::inverse(field2::to_montgomery(field1::mod - field2::mod));
+    double_limb_t carry = 0;
+    std::fill(r, r + rn, 0);
+    for (size_t i = 0; i != rn * digits_per_limb; ++i)
+    {
+        limb_t x1 = f1[i];
+        limb_t y = field2::mul(field2::sub(f2[i], field2::normalize(x1)), inv_p1);
+        carry += x1 + static_cast<double_limb_t>(field1::mod) * y;
+        r[i / digits_per_limb] |= (static_cast<limb_t>(carry) & digit_mask) << (i % digits_per_limb * digit_bits);
+        carry >>= digit_bits;
+    }
+}
+}
@@ -0,0 +1,284 @@
+#include "big_integer_parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef BIG_INTEGER_PARALLEL_THRESHOLD
+#define BIG_INTEGER_PARALLEL_THRESHOLD 16384
+#endif
+
+namespace kernels
+{
+size_t parallel_threshold = BIG_INTEGER_PARALLEL_THRESHOLD;
+
+namespace
+{
+// the tasks of one fork_join call
+struct group
+{
+    std::atomic<size_t> pending;
+    std::mutex mutex;
+    std::exception_ptr error;
+};
+
+struct task
+{
+    std::function<void()> const* run;
+    group* owner;
+};
+
+struct queue
+{
+    std::mutex mutex;
+    std::deque<task> tasks;
+};
+
+// queues[0] belongs to the threads outside the pool, queues[i] to worker i
+thread_local size_t current = 0;
+
+class pool
+{
+public:
+    pool()
+        : threads_(std::max(std::thread::hardware_concurrency(), 1u))
+        , started_(false)
+        , queued_(0)
+        , stopping_(false)
+    {}
+
+    ~pool()
+    {
+        stop();
+    }
+
+    size_t threads() const
+    {
+        return threads_;
+    }
+
+    void resize(size_t threads)
+    {
+        stop();
+        threads_ = std::max<size_t>(threads, 1);
+    }
+
+    void push(task const& t)
+    {
+        start();
+        // counted first, so that queued_ never runs below the number of tasks
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            ++queued_;
+        }
+        queue& q = *queues_[current];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(t);
+        }
+        wake_.notify_one();
+    }
+
+    // runs a task; the last one of a group wakes the threads waiting for it,
+    // and nothing touches the group after its count reaches zero, since its
+    // waiter may then return and destroy it
+    void execute(task const& t)
+    {
+        try
+        {
+            (*t.run)();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(t.owner->mutex);
+            if (!t.owner->error)
+            {
+                t.owner->error = std::current_exception();
+            }
+        }
+        if (t.owner->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            wake_.notify_all();
+        }
+    }
+
+    // the newest task of this thread, or else the oldest of another one
+    bool pop(task& t)
+    {
+        if (queued_.load(std::memory_order_relaxed) == 0)
+        {
+            return false;
+        }
+        for (size_t i = 0; i != queues_.size(); ++i)
+        {
+            queue& q = *queues_[(current + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty())
+            {
+                if (i == 0)
+                {
+                    t = q.tasks.back();
+                    q.tasks.pop_back();
+                }
+                else
+                {
+                    t = q.tasks.front();
+                    q.tasks.pop_front();
+                }
+                --queued_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // runs queued tasks until those of g have finished; with nothing to
+    // steal it yields for a few rounds and then sleeps until the group
+    // finishes or more work is queued, rather than spin through a long task
+    void wait(group& g)
+    {
+        size_t const spin_rounds = 64;
+        task t;
+        size_t idle = 0;
+        while (g.pending.load(std::memory_order_acquire) != 0)
+        {
+            if (pop(t))
+            {
+                execute(t);
+                idle = 0;
+            }
+            else if (++idle < spin_rounds)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::unique_lock<std::mutex> lock(sleep_mutex_);
+                wake_.wait(lock, [this, &g] {
+                    return g.pending.load(std::memory_order_acquire) == 0 || queued_ != 0;
+                });
+                idle = 0;
+            }
+        }
+    }
+
+private:
+    void start()
+    {
+        if (started_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(start_mutex_);
+        if (!started_.load(std::memory_order_relaxed))
+        {
+            for (size_t i = 0; i != threads_; ++i)
+            {
+                queues_.emplace_back(new queue);
+            }
+            for (size_t i = 1; i != threads_; ++i)
+            {
+                workers_.emplace_back([this, i] { work(i); });
+            }
+            started_.store(true, std::memory_order_release);
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+        workers_.clear();
+        queues_.clear();
+        stopping_ = false;
+        started_ = false;
+    }
+
+    void work(size_t index)
+    {
+        current = index;
+        task t;
+        for (;;)
+        {
+            if (pop(t))
+            {
+                execute(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_.wait(lock, [this] { return stopping_ || queued_ != 0; });
+            if (stopping_)
+            {
+                return;
+            }
+        }
+    }
+
+    size_t threads_;
+    std::atomic<bool> started_;
+    std::mutex start_mutex_;
+    std::vector<std::unique_ptr<queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+};
+
+pool& instance()
+{
+    static pool p;
+    return p;
+}
+}
+
+size_t thread_count()
+{
+    return instance().threads();
+}
+
+void set_thread_count(size_t threads)
+{
+    instance().resize(threads);
+}
+
+void fork_join(std::function<void()> const* tasks, size_t count)
+{
+    pool& p = instance();
+    if (p.threads() == 1)
+    {
+        for (size_t i = 0; i != count; ++i)
+        {
+            tasks[i]();
+        }
+        return;
+    }
+    group g;
+    g.pending = count;
+    for (size_t i = 1; i < count; ++i)
+    {
+        p.push(task{tasks + i, &g});
+    }
+    if (count != 0)
+    {
+        p.execute(task{tasks, &g});
+    }
+    p.wait(g);
+    if (g.error)
+    {
+        std::rethrow_exception(g.error);
+    }
+}
+}
@@ -0,0 +1,48 @@
+#ifndef BIG_INTEGER_PARALLEL_H
+#define BIG_INTEGER_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "big_integer_kernels.h"
+
+// Fork-join parallelism for the multiplication kernels, on a pool of
+// thread_count() - 1 workers that start on the first fork. Each worker keeps
+// its own deque of tasks: it runs the newest of its own tasks first and,
+// when it has none, steals the oldest from the others. A thread waiting for
+// its tasks to finish runs queued tasks meanwhile, so forks can nest to any
+// depth without blocking a worker, and sleeps when there are none to run.
+
+namespace kernels
+{
+// Runs tasks[0..count) and returns when all have finished; the caller takes
+// part in the work. If a task throws, the first exception is rethrown once
+// every task has finished. With a single thread the tasks run in order.
+void fork_join(std::function<void()> const* tasks, size_t count);
+
+// f(begin, end) over [0, n) in slices of at least grain items, or in one
+// call on a single thread
+template<typename F>
+void parallel_for(size_t n, size_t grain, F f)
+{
+    size_t threads = thread_count();
+    size_t slices = std::min(n / std::max<size_t>(grain, 1), 4 * threads);
+    if (slices < 2 || threads == 1)
+    {
+        f(size_t(0), n);
+        return;
+    }
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i != slices; ++i)
+    {
+        size_t begin = n * i / slices;
+        size_t end = n * (i + 1) / slices;
+        tasks.push_back([=, &f] { f(begin, end); });
+    }
+    fork_join(tasks.data(), tasks.size());
+}
+}
+
+#endif // BIG_INTEGER_PARALLEL_H
@@ -0,0 +1,176 @@
+#include "big_integer_kernels.h"
+
+#include <algorithm>
+#include <vector>
+
+// Conversion between limbs and decimal digits. Both directions split the
+// number at the powers 10^(19 * 2^k), which each thread computes once by
+// repeated squaring and keeps for later calls.
+
+namespace kernels
+{
+namespace
+{
+limb_t const decimal_base = 10000000000000000000ull;
+size_t const decimal_base_digits = 19;
+
+// pieces of at most 19 * 2^basecase_level digits are converted limb by limb
+size_t const basecase_level = 5;
+
+typedef std::vector<limb_t> limbs_t;
+
+// powers[k] = 10^(19 * 2^k), extended as far as level and never shrunk; the
+// returned pointer stays valid until the next call
+limbs_t const* decimal_powers(size_t level)
+{
+    thread_local std::vector<limbs_t> powers(1, limbs_t(1, decimal_base));
+    while (powers.size() <= level)
+    {
+        limbs_t const& p = powers.back();
+        limbs_t square(2 * p.size());
+        mul(square.data(), p.data(), p.size(), p.data(), p.size());
+        square.resize(normalized_size(square.data(), square.size()));
+        powers.push_back(std::move(square));
+    }
+    return powers.data();
+}
+
+size_t level_width(size_t level)
+{
+    return decimal_base_digits << level;
+}
+
+// writes exactly level_width(level) digits of a < 10^level_width(level)
+void write_decimal(char* out, size_t level, limb_t const* a, size_t n, limbs_t const* powers)
+{
+    size_t width = level_width(level);
+    if (n == 0)
+    {
+        std::fill(out, out + width, '0');
+        return;
+    }
+    if (level <= basecase_level)
+    {
+        limbs_t t(a, a + n);
+        char* p = out + width;
+        while (n != 0)
+        {
+            limb_t chunk = divrem_1(t.data(), t.data(), n, decimal_base);
+            n = normalized_size(t.data(), n);
+            for (size_t i = 0; i != decimal_base_digits; ++i)
+            {
+                *--p = static_cast<char>('0' + chunk % 10);
+                chunk /= 10;
+            }
+        }
+        std::fill(out, p, '0');
+        return;
+    }
+
+    limbs_t const& divisor = powers[level - 1];
+    size_t dn = divisor.size();
+    size_t half = width / 2;
+    if (cmp(a, n, divisor.data(), dn) < 0)
+    {
+        std::fill(out, out + half, '0');
+        write_decimal(out + half, level - 1, a, n, powers);
+        return;
+    }
+    limbs_t q(n - dn + 1);
+    limbs_t r(dn);
+    divrem(q.data(), r.data(), a, n, divisor.data(), dn);
+    write_decimal(out, level - 1, q.data(), normalized_size(q.data(), q.size()), powers);
+    write_decimal(out + half, level - 1, r.data(), normalized_size(r.data(), r.size()), powers);
+}
+
+limbs_t read_decimal(char const* digits, size_t length, limbs_t const* powers)
+{
+    limbs_t r;
+    if (length <= level_width(basecase_level))
+    {
+        size_t chunk_length = length % decimal_base_digits;
+        if (chunk_length == 0)
+        {
+            chunk_length = decimal_base_digits;
+        }
+        for (char const* end = digits + length; digits != end;)
+        {
+            limb_t chunk = 0;
+            limb_t scale = 1;
+            for (char const* chunk_end = digits + chunk_length; digits != chunk_end; ++digits)
+            {
+                chunk = chunk * 10 + static_cast<limb_t>(*digits - '0');
+                scale *= 10;
+            }
+            limb_t carry = mul_1(r.data(), r.data(), r.size(), scale);
+            carry += add_1(r.data(), r.data(), r.size(), chunk);
+            if (carry != 0)
+            {
+                r.push_back(carry);
+            }
+            chunk_length = decimal_base_digits;
+        }
+        return r;
+    }
+
+    // the low part is the largest piece of level_width(level) digits
+    size_t level = basecase_level;
+    while (level_width(level + 1) < length)
+    {
+        ++level;
+    }
+    size_t low_length = level_width(level);
+    limbs_t high = read_decimal(digits, length - low_length, powers);
+    limbs_t low = read_decimal(digits + length - low_length, low_length, powers);
+    limbs_t const& scale = powers[level];
+    if (high.empty())
+    {
+        return low;
+    }
+
+    r.resize(high.size() + scale.size());
+    if (high.size() >= scale.size())
+    {
+        mul(r.data(), high.data(), high.size(), scale.data(), scale.size());
+    }
+    else
+    {
+        mul(r.data(), scale.data(), scale.size(), high.data(), high.size());
+    }
+    if (!low.empty())
+    {
+        add(r.data(), r.data(), r.size(), low.data(), low.size());
+    }
+    r.resize(normalized_size(r.data(), r.size()));
+    return r;
+}
+}
+
+size_t to_decimal(char* out, limb_t const* a, size_t n)
+{
+    size_t level = 0;
+    limbs_t const* powers = decimal_powers(level);
+    while (cmp(a, n, powers[level].data(), powers[level].size()) >= 0)
+    {
+        powers = decimal_powers(++level);
+    }
+
+    std::vector<char> digits(level_width(level));
+    write_decimal(digits.data(), level, a, n, powers);
+    std::vector<char>::const_iterator first = std::find_if(digits.begin(), digits.end(),
+                                                           [](char c) { return c != '0'; });
+    return static_cast<size_t>(std::copy(first, digits.cend(), out) - out);
+}
+
+size_t from_decimal(limb_t* r, char const* digits, size_t length)
+{
+    size_t level = 0;
+    while (level_width(level + 1) < length)
+    {
+        ++level;
+    }
+    limbs_t value = read_decimal(digits, length, decimal_powers(level));
+    std::copy(value.begin(), value.end(), r);
+    return value.size();
+}
+}
@@ -0,0 +1,477 @@
+#include "big_integer_storage.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#ifndef BIG_INTEGER_LIMB_POOL
+#define BIG_INTEGER_LIMB_POOL 0
+#endif
+
+namespace
+{
+thread_local limb_allocator* current_allocator = nullptr;
+
+typedef limb_storage::limb_t limb_t;
+
+static_assert(sizeof(limb_allocator*) <= sizeof(limb_t), "the allocator of a buffer must fit in a limb");
+
+// a buffer of capacity limbs is preceded by one more that holds its allocator
+// and, with shared storage, one between them for its reference count
+size_t const header_limbs = 1 + BIG_INTEGER_SHARED_STORAGE;
+
+size_t buffer_bytes(size_t capacity)
+{
+    return (capacity + header_limbs) * sizeof(limb_t);
+}
+
+#if BIG_INTEGER_LIMB_POOL
+
+// Buffers up to max_pooled_words words are pooled, in classes of exact sizes
+// up to 8 words and then of four sizes per power of two, so a buffer wastes
+// at most a quarter of its size. A freed buffer holds the next one of its
+// list in its first word.
+size_t const exact_classes = 8;
+size_t const max_pooled_words = size_t(1) << 13;
+size_t const class_count = exact_classes + 4 * 10;
+size_t const max_cached_bytes = size_t(1) << 18;
+
+struct free_buffer
+{
+    free_buffer* next;
+};
+
+// plain data, so that it is still usable while thread_local objects with
+// destructors are being destroyed
+struct pool
+{
+    free_buffer* lists[class_count];
+    size_t counts[class_count];
+    limb_pool_statistics statistics;
+    ptrdiff_t in_use_at_reset;
+    bool closed;
+};
+
+thread_local pool local_pool;
+
+// the class of a buffer of the given number of words and the words it holds
+size_t size_class(size_t words, size_t& class_words)
+{
+    if (words <= exact_classes)
+    {
+        class_words = words;
+        return words - 1;
+    }
+    size_t k = 0;
+    while ((size_t(2) << k) < words)
+    {
+        ++k;
+    }
+    // 2^k < words <= 2^(k + 1), in steps of 2^(k - 2)
+    size_t step = size_t(1) << (k - 2);
+    size_t m = (words + step - 1) / step;
+    class_words = m * step;
+    return exact_classes + 4 * (k - 3) + (m - 5);
+}
+
+void trim(pool& p)
+{
+    for (size_t i = 0; i != class_count; ++i)
+    {
+        while (free_buffer* f = p.lists[i])
+        {
+            p.lists[i] = f->next;
+            operator delete(f);
+        }
+        p.counts[i] = 0;
+    }
+    p.statistics.cached = 0;
+}
+
+// empties the pool when its thread exits, from then on buffers bypass it
+struct pool_guard
+{
+    ~pool_guard()
+    {
+        local_pool.closed = true;
+        trim(local_pool);
+    }
+};
+
+thread_local pool_guard local_pool_guard;
+
+void track(pool& p, ptrdiff_t bytes)
+{
+    p.statistics.in_use += bytes;
+    ptrdiff_t rise = p.statistics.in_use - p.in_use_at_reset;
+    if (rise > 0 && static_cast<size_t>(rise) > p.statistics.peak)
+    {
+        p.statistics.peak = static_cast<size_t>(rise);
+    }
+}
+
+void* default_allocate(size_t bytes)
+{
+    pool& p = local_pool;
+    size_t words = bytes / sizeof(limb_t);
+    size_t class_words = words;
+    if (words <= max_pooled_words && !p.closed)
+    {
+        size_t c = size_class(words, class_words);
+        if (free_buffer* f = p.lists[c])
+        {
+            p.lists[c] = f->next;
+            --p.counts[c];
+            ++p.statistics.hits;
+            p.statistics.cached -= class_words * sizeof(limb_t);
+            track(p, static_cast<ptrdiff_t>(class_words * sizeof(limb_t)));
+            return f;
+        }
+    }
+    void* result = operator new(class_words * sizeof(limb_t));
+    ++p.statistics.misses;
+    track(p, static_cast<ptrdiff_t>(class_words * sizeof(limb_t)));
+    return result;
+}
+
+void default_deallocate(void* block, size_t bytes)
+{
+    pool& p = local_pool;
+    size_t words = bytes / sizeof(limb_t);
+    size_t class_words = words;
+    size_t c = words <= max_pooled_words ? size_class(words, class_words) : class_count;
+    track(p, -static_cast<ptrdiff_t>(class_words * sizeof(limb_t)));
+    if (c == class_count || p.closed || (p.counts[c] + 1) * class_words * sizeof(limb_t) > max_cached_bytes)
+    {
+        operator delete(block);
+        return;
+    }
+    // the guard is only registered for destruction once it is used
+    static_cast<void>(&local_pool_guard);
+    free_buffer* f = static_cast<free_buffer*>(block);
+    f->next = p.lists[c];
+    p.lists[c] = f;
+    ++p.counts[c];
+    p.statistics.cached += class_words * sizeof(limb_t);
+}
+
+#else
+
+void* default_allocate(size_t bytes)
+{
+    return operator new(bytes);
+}
+
+void default_deallocate(void* block, size_t)
+{
+    operator delete(block);
+}
+
+#endif
+
+limb_t* allocate(size_t capacity)
+{
+    limb_allocator* owner = current_allocator;
+    void* p = owner != nullptr ? owner->allocate(buffer_bytes(capacity)) : default_allocate(buffer_bytes(capacity));
+    *static_cast<limb_allocator**>(p) = owner;
+    limb_t* limbs = static_cast<limb_t*>(p) + header_limbs;
+#if BIG_INTEGER_SHARED_STORAGE
+    new (limbs - 1) std::atomic<size_t>(1);
+#endif
+    return limbs;
+}
+
+void deallocate(limb_t* p, size_t capacity)
+{
+    void* block = p - header_limbs;
+    limb_allocator* owner = *static_cast<limb_allocator**>(block);
+    if (owner != nullptr)
+    {
+        owner->deallocate(block, buffer_bytes(capacity));
+    }
+    else
+    {
+        default_deallocate(block, buffer_bytes(capacity));
+    }
+}
+
+#if BIG_INTEGER_SHARED_STORAGE
+std::atomic<size_t>& references(limb_t* p)
+{
+    return *reinterpret_cast<std::atomic<size_t>*>(p - 1);
+}
+
+// copies share a buffer only under the allocator it came from, so that a
+// value is still copied out of an arena
+bool sharable(limb_t* p)
+{
+    return *reinterpret_cast<limb_allocator**>(p - header_limbs) == current_allocator;
+}
+#endif
+
+// drops a reference to a buffer, the last one frees it
+void release(limb_t* p, size_t capacity)
+{
+#if BIG_INTEGER_SHARED_STORAGE
+    if (references(p).fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+#endif
+    deallocate(p, capacity);
+}
+}
+
+limb_pool_statistics limb_pool_stats()
+{
+#if BIG_INTEGER_LIMB_POOL
+    return local_pool.statistics;
+#else
+    return limb_pool_statistics();
+#endif
+}
+
+void reset_limb_pool_stats()
+{
+#if BIG_INTEGER_LIMB_POOL
+    pool& p = local_pool;
+    p.statistics.hits = 0;
+    p.statistics.misses = 0;
+    p.statistics.peak = 0;
+    p.in_use_at_reset = p.statistics.in_use;
+#endif
+}
+
+void trim_limb_pool()
+{
+#if BIG_INTEGER_LIMB_POOL
+    trim(local_pool);
+#endif
+}
+
+limb_allocator* current_limb_allocator()
+{
+    return current_allocator;
+}
+
+void set_limb_allocator(limb_allocator* allocator)
+{
+    current_allocator = allocator;
+}
+
+scoped_limb_allocator::scoped_limb_allocator(limb_allocator& allocator)
+    : previous_(current_allocator)
+{
+    current_allocator = &allocator;
+}
+
+scoped_limb_allocator::~scoped_limb_allocator()
+{
+    current_allocator = previous_;
+}
+
+limb_arena::limb_arena(size_t block_size)
+    : block_size_(std::max<size_t>(block_size, sizeof(limb_t)))
+    , top_(nullptr)
+    , left_(0)
+    , allocated_(0)
+{}
+
+limb_arena::~limb_arena()
+{
+    for (void* block : blocks_)
+    {
+        operator delete(block);
+    }
+}
+
+void* limb_arena::allocate(size_t bytes)
+{
+    bytes = (bytes + sizeof(limb_t) - 1) / sizeof(limb_t) * sizeof(limb_t);
+    if (bytes > left_)
+    {
+        // each block at least doubles the arena, so large computations take
+        // a logarithmic number of them
+        size_t size = std::max(bytes, blocks_.empty() ? block_size_ : 2 * block_size_);
+        blocks_.reserve(blocks_.size() + 1);
+        top_ = static_cast<char*>(operator new(size));
+        blocks_.push_back(top_);
+        block_size_ = size;
+        left_ = size;
+    }
+    void* p = top_;
+    top_ += bytes;
+    left_ -= bytes;
+    allocated_ += bytes;
+    return p;
+}
+
+void limb_arena::deallocate(void*, size_t) noexcept
+{}
+
+void limb_arena::release()
+{
+    if (blocks_.empty())
+    {
+        return;
+    }
+    // the last block is the largest
+    for (size_t i = 0; i + 1 < blocks_.size(); ++i)
+    {
+        operator delete(blocks_[i]);
+    }
+    blocks_.front() = blocks_.back();
+    blocks_.resize(1);
+    top_ = static_cast<char*>(blocks_.front());
+    left_ = block_size_;
+    allocated_ = 0;
+}
+
+size_t limb_arena::allocated() const
+{
+    return allocated_;
+}
+
+limb_storage::limb_storage()
+    : size_(0)
+    , capacity_(inline_capacity)
+{}
+
+limb_storage::limb_storage(size_t size)
+    : size_(0)
+    , capacity_(inline_capacity)
+{
+    resize(size);
+}
+
+limb_storage::limb_storage(limb_storage const& other)
+    : size_(0)
+    , capacity_(inline_capacity)
+{
+#if BIG_INTEGER_SHARED_STORAGE
+    if (!other.is_inline() && sharable(other.buffer_.heap))
+    {
+        references(other.buffer_.heap).fetch_add(1, std::memory_order_relaxed);
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        buffer_ = other.buffer_;
+        return;
+    }
+#endif
+    assign(other.begin(), other.end());
+}
+
+limb_storage& limb_storage::operator=(limb_storage const& other)
+{
+#if BIG_INTEGER_SHARED_STORAGE
+    if (!other.is_inline() && sharable(other.buffer_.heap))
+    {
+        limb_storage tmp(other);
+        swap(tmp);
+        return *this;
+    }
+#endif
+    if (this != &other)
+    {
+        assign(other.begin(), other.end());
+    }
+    return *this;
+}
+
+limb_storage::limb_storage(limb_storage&& other) noexcept
+    : size_(other.size_)
+    , capacity_(other.capacity_)
+    , buffer_(other.buffer_)
+{
+    other.size_ = 0;
+    other.capacity_ = inline_capacity;
+}
+
+limb_storage& limb_storage::operator=(limb_storage&& other) noexcept
+{
+    limb_storage tmp(std::move(other));
+    swap(tmp);
+    return *this;
+}
+
+limb_storage::~limb_storage()
+{
+    if (!is_inline())
+    {
+        release(buffer_.heap, capacity_);
+    }
+}
+
+void limb_storage::reserve(size_t capacity)
+{
+    if (capacity > capacity_)
+    {
+        reallocate(capacity);
+    }
+}
+
+void limb_storage::resize(size_t size)
+{
+    if (size > capacity_)
+    {
+        reallocate(std::max(size, capacity_ * 2));
+    }
+    if (size > size_)
+    {
+        std::fill(data() + size_, data() + size, 0);
+    }
+    size_ = size;
+}
+
+void limb_storage::assign(limb_t const* first, limb_t const* last)
+{
+    size_t size = static_cast<size_t>(last - first);
+#if BIG_INTEGER_SHARED_STORAGE
+    // a shared buffer is left to the other copies rather than cloned
+    bool replace = size > capacity_ || (!is_inline() && is_shared());
+#else
+    bool replace = size > capacity_;
+#endif
+    if (replace)
+    {
+        limb_t* p = allocate(std::max(size, inline_capacity + 1));
+        if (!is_inline())
+        {
+            release(buffer_.heap, capacity_);
+        }
+        buffer_.heap = p;
+        capacity_ = std::max(size, inline_capacity + 1);
+    }
+    std::copy(first, last, data());
+    size_ = size;
+}
+
+void limb_storage::swap(limb_storage& other) noexcept
+{
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(buffer_, other.buffer_);
+}
+
+void limb_storage::reallocate(size_t new_capacity)
+{
+    limb_t* p = allocate(new_capacity);
+    limb_storage const& self = *this;
+    std::copy(self.begin(), self.end(), p);
+    if (!is_inline())
+    {
+        release(buffer_.heap, capacity_);
+    }
+    buffer_.heap = p;
+    capacity_ = new_capacity;
+}
+
+#if BIG_INTEGER_SHARED_STORAGE
+void limb_storage::unshare()
+{
+    limb_t* p = allocate(capacity_);
+    std::copy(buffer_.heap, buffer_.heap + size_, p);
+    release(buffer_.heap, capacity_);
+    buffer_.heap = p;
+}
+#endif
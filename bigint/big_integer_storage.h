@@ -0,0 +1,281 @@
+#ifndef BIG_INTEGER_STORAGE_H
+#define BIG_INTEGER_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef BIG_INTEGER_SHARED_STORAGE
+#define BIG_INTEGER_SHARED_STORAGE 0
+#endif
+
+#if BIG_INTEGER_SHARED_STORAGE
+#include <atomic>
+#endif
+
+// Source of the heap buffers of limb_storage. Every buffer records the
+// allocator it came from and goes back to it when it is freed, so a value may
+// be moved to, or destroyed by, code running under another allocator, as long
+// as its own allocator is still alive.
+class limb_allocator
+{
+public:
+    virtual ~limb_allocator() = default;
+
+    virtual void* allocate(size_t bytes) = 0;
+    virtual void deallocate(void* p, size_t bytes) noexcept = 0;
+};
+
+// The allocator of the buffers allocated by the calling thread; nullptr, the
+// default, stands for operator new. Threads do not inherit it, so the workers
+// of the thread pool always use operator new.
+limb_allocator* current_limb_allocator();
+void set_limb_allocator(limb_allocator* allocator);
+
+// Counters of the buffer pool that replaces operator new above when the
+// library is built with BIG_INTEGER_LIMB_POOL: each thread keeps free lists
+// of recently freed buffers by size class and hands them out again without
+// locking. A buffer freed on another thread goes back to that thread's lists.
+// The counters are per thread and count a buffer where it is allocated and
+// again where it is freed, so they describe the calling thread's own buffers
+// only when no other thread frees them or hands it theirs, as the workers of
+// fork_join do for large products. Without the pool every counter stays zero.
+struct limb_pool_statistics
+{
+    size_t hits;        // buffers taken from the free lists
+    size_t misses;      // buffers taken from operator new
+    ptrdiff_t in_use;   // bytes handed out and not yet freed on this thread,
+                        // negative once it frees those of other threads
+    size_t peak;        // the largest rise of in_use since the last reset
+    size_t cached;      // bytes held in the free lists
+};
+
+limb_pool_statistics limb_pool_stats();
+void reset_limb_pool_stats();
+// returns the cached buffers of the calling thread to operator delete
+void trim_limb_pool();
+
+// Installs an allocator for the calling thread until the end of the scope.
+class scoped_limb_allocator
+{
+public:
+    explicit scoped_limb_allocator(limb_allocator& allocator);
+    scoped_limb_allocator(scoped_limb_allocator const&) = delete;
+    scoped_limb_allocator& operator=(scoped_limb_allocator const&) = delete;
+    ~scoped_limb_allocator();
+
+private:
+    limb_allocator* previous_;
+};
+
+// Bump allocator for short-lived computations: buffers are carved out of
+// large blocks and only freed all at once, by release() or the destructor.
+// Freeing a single buffer does nothing, so that may happen on any thread, but
+// allocation must stay on one thread at a time. Values that outlive the
+// computation have to be copied out under another allocator first.
+class limb_arena : public limb_allocator
+{
+public:
+    explicit limb_arena(size_t block_size = 1 << 16);
+    limb_arena(limb_arena const&) = delete;
+    limb_arena& operator=(limb_arena const&) = delete;
+    ~limb_arena() override;
+
+    void* allocate(size_t bytes) override;
+    void deallocate(void* p, size_t bytes) noexcept override;
+
+    // frees every buffer, keeping the largest block for reuse
+    void release();
+    // bytes handed out since the last release
+    size_t allocated() const;
+
+private:
+    std::vector<void*> blocks_;
+    size_t block_size_;
+    char* top_;
+    size_t left_;
+    size_t allocated_;
+};
+
+// Limb buffer with the interface of a minimal std::vector that keeps up to
+// inline_capacity limbs inside the object, so small values never allocate.
+// Larger buffers come from the current limb_allocator.
+//
+// Built with BIG_INTEGER_SHARED_STORAGE, copies made under the allocator of
+// a heap buffer share it under an atomic reference count, and the first
+// mutable access to a buffer that is shared clones it (copy on write). The
+// mutable accessors may then throw, and the pointers they return are only
+// good until the object is next copied.
+struct limb_storage
+{
+    typedef uint64_t limb_t;
+    typedef limb_t* iterator;
+    typedef limb_t const* const_iterator;
+
+    static size_t const inline_capacity = 2;
+
+    limb_storage();                                     // O(1) nothrow
+    explicit limb_storage(size_t size);                 // O(N) strong, zero-filled
+    limb_storage(limb_storage const& other);            // O(N) strong, O(1) nothrow when shared
+    limb_storage& operator=(limb_storage const& other); // O(N) strong, O(1) nothrow when shared
+    limb_storage(limb_storage&& other) noexcept;        // O(1) nothrow
+    limb_storage& operator=(limb_storage&& other) noexcept; // O(1) nothrow
+
+    ~limb_storage();                                    // O(1) nothrow
+
+    limb_t& operator[](size_t i);                       // O(1) nothrow, or O(N) strong when shared
+    limb_t const& operator[](size_t i) const;           // O(1) nothrow
+
+    limb_t* data();                                     // O(1) nothrow, or O(N) strong when shared
+    limb_t const* data() const;                         // O(1) nothrow
+    size_t size() const;                                // O(1) nothrow
+    bool empty() const;                                 // O(1) nothrow
+    size_t capacity() const;                            // O(1) nothrow
+
+    limb_t& back();                                     // O(1) nothrow, or O(N) strong when shared
+    limb_t const& back() const;                         // O(1) nothrow
+    void push_back(limb_t value);                       // O(1)* strong
+    void pop_back();                                    // O(1) nothrow
+
+    void reserve(size_t capacity);                      // O(N) strong
+    void resize(size_t size);                           // O(N) strong, zero-fills new limbs
+    void assign(limb_t const* first, limb_t const* last); // O(N) strong
+    void clear();                                       // O(1) nothrow
+
+    void swap(limb_storage& other) noexcept;            // O(1) nothrow
+
+    iterator begin();                                   // O(1) nothrow, or O(N) strong when shared
+    iterator end();                                     // O(1) nothrow, or O(N) strong when shared
+
+    const_iterator begin() const;                       // O(1) nothrow
+    const_iterator end() const;                         // O(1) nothrow
+
+private:
+    bool is_inline() const;
+    void reallocate(size_t new_capacity);
+#if BIG_INTEGER_SHARED_STORAGE
+    bool is_shared() const;
+    void unshare();
+#endif
+
+private:
+    union buffer
+    {
+        limb_t small[inline_capacity];
+        limb_t* heap;
+    };
+
+    size_t size_;
+    size_t capacity_;
+    buffer buffer_;
+};
+
+inline bool limb_storage::is_inline() const
+{
+    return capacity_ == inline_capacity;
+}
+
+inline limb_storage::limb_t& limb_storage::operator[](size_t i)
+{
+    return data()[i];
+}
+
+inline limb_storage::limb_t const& limb_storage::operator[](size_t i) const
+{
+    return data()[i];
+}
+
+#if BIG_INTEGER_SHARED_STORAGE
+// the reference count of a heap buffer is kept in the limb in front of it
+inline bool limb_storage::is_shared() const
+{
+    static_assert(sizeof(std::atomic<size_t>) == sizeof(limb_t), "the reference count must fit in a limb");
+    return reinterpret_cast<std::atomic<size_t> const*>(buffer_.heap - 1)->load(std::memory_order_acquire) != 1;
+}
+#endif
+
+inline limb_storage::limb_t* limb_storage::data()
+{
+    if (is_inline())
+    {
+        return buffer_.small;
+    }
+#if BIG_INTEGER_SHARED_STORAGE
+    if (is_shared())
+    {
+        unshare();
+    }
+#endif
+    return buffer_.heap;
+}
+
+inline limb_storage::limb_t const* limb_storage::data() const
+{
+    return is_inline() ? buffer_.small : buffer_.heap;
+}
+
+inline size_t limb_storage::size() const
+{
+    return size_;
+}
+
+inline bool limb_storage::empty() const
+{
+    return size_ == 0;
+}
+
+inline size_t limb_storage::capacity() const
+{
+    return capacity_;
+}
+
+inline limb_storage::limb_t& limb_storage::back()
+{
+    return data()[size_ - 1];
+}
+
+inline limb_storage::limb_t const& limb_storage::back() const
+{
+    return data()[size_ - 1];
+}
+
+inline void limb_storage::push_back(limb_t value)
+{
+    if (size_ == capacity_)
+    {
+        reallocate(capacity_ * 2);
+    }
+    data()[size_++] = value;
+}
+
+inline void limb_storage::pop_back()
+{
+    --size_;
+}
+
+inline void limb_storage::clear()
+{
+    size_ = 0;
+}
+
+inline limb_storage::iterator limb_storage::begin()
+{
+    return data();
+}
+
+inline limb_storage::iterator limb_storage::end()
+{
+    return data() + size_;
+}
+
+inline limb_storage::const_iterator limb_storage::begin() const
+{
+    return data();
+}
+
+inline limb_storage::const_iterator limb_storage::end() const
+{
+    return data() + size_;
+}
+
+#endif // BIG_INTEGER_STORAGE_H
@@ -1,13 +1,21 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <functional>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include <utility>
 #include <gtest/gtest.h>
 
 #include "big_integer.h"
+#include "big_integer_fixed.h"
 #include "big_integer_gmp.h"
+#include "big_integer_kernels.h"
+#include "big_integer_montgomery.h"
+#include "big_integer_parallel.h"
 
 TEST(correctness, two_plus_two) {
   EXPECT_EQ(big_integer(4), big_integer(2) + big_integer(2));
@@ -52,6 +60,92 @@ TEST(correctness, copy_ctor_real_copy2) {
   EXPECT_EQ(3, a);
 }
 
+// values on the heap, whose copies may share their limbs
+TEST(correctness, copy_real_copy_large) {
+  big_integer const x = (big_integer(1) << 1000) + 12345;
+  big_integer a = x;
+  big_integer b = a;
+  big_integer c;
+  c = a;
+  big_integer d = a;
+  big_integer e(a);
+
+  b += 1;
+  c *= 3;
+  d <<= 100;
+  e /= 7;
+  EXPECT_EQ(x, a);
+  EXPECT_EQ(x + 1, b);
+  EXPECT_EQ(x * 3, c);
+  EXPECT_EQ(x * (big_integer(1) << 100), d);
+  EXPECT_EQ(x - x % 7, e * 7);
+
+  big_integer f = a;
+  a = 5;
+  EXPECT_EQ(x, f);
+  a = f;
+  f = f;
+  --f;
+  EXPECT_EQ(x, a);
+  EXPECT_EQ(x - 1, f);
+}
+
+TEST(correctness, copies_across_threads) {
+  big_integer const x = (big_integer(1) << 5000) - 1;
+  size_t const threads = kernels::thread_count();
+  kernels::set_thread_count(4);
+  std::vector<big_integer> copies(64, x);
+  std::vector<big_integer> results(copies.size());
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i != copies.size(); ++i) {
+    tasks.push_back([&, i] {
+      big_integer y = copies[i];
+      copies[i] += static_cast<int>(i);
+      results[i] = copies[i] - y;
+    });
+  }
+  kernels::fork_join(tasks.data(), tasks.size());
+  kernels::set_thread_count(threads);
+  for (size_t i = 0; i != copies.size(); ++i) {
+    EXPECT_EQ(static_cast<int>(i), results[i]);
+    EXPECT_EQ(x + static_cast<int>(i), copies[i]);
+  }
+  EXPECT_EQ((big_integer(1) << 5000) - 1, x);
+}
+
+TEST(correctness, move_ctor) {
+  big_integer a("123456789012345678901234567890");
+  big_integer b = std::move(a);
+
+  EXPECT_EQ(big_integer("123456789012345678901234567890"), b);
+  a = 5;
+  EXPECT_EQ(5, a);
+}
+
+TEST(correctness, move_assignment) {
+  big_integer a("-123456789012345678901234567890");
+  big_integer b = 3;
+  b = std::move(a);
+
+  EXPECT_EQ(big_integer("-123456789012345678901234567890"), b);
+  a = b;
+  EXPECT_EQ(b, a);
+}
+
+TEST(correctness, rvalue_operands) {
+  big_integer a("100000000000000000000000000000000000000");
+  big_integer b("-3");
+
+  EXPECT_EQ(big_integer("99999999999999999999999999999999999997"), a + (b * 1));
+  EXPECT_EQ(big_integer("100000000000000000000000000000000000003"), a - (b * 1));
+  EXPECT_EQ(big_integer("-100000000000000000000000000000000000003"), b - (a * 1));
+  EXPECT_EQ(a & b, a & (b * 1));
+  EXPECT_EQ(a | b, a | (b * 1));
+  EXPECT_EQ(a ^ b, a ^ (b * 1));
+  EXPECT_EQ(-a, -(a * 1));
+  EXPECT_EQ(~b, ~(b * 1));
+}
+
 TEST(correctness, assignment_operator) {
   big_integer a = 4;
   big_integer b = 7;
@@ -249,6 +343,168 @@ TEST(correctness, div_return_value) {
   EXPECT_EQ(25, a);
 }
 
+TEST(correctness, divmod) {
+  std::pair<big_integer, big_integer> qr = divmod(big_integer(-23), big_integer(5));
+  EXPECT_EQ(-4, qr.first);
+  EXPECT_EQ(-3, qr.second);
+
+  qr = divmod(big_integer(3), big_integer(-5));
+  EXPECT_EQ(0, qr.first);
+  EXPECT_EQ(3, qr.second);
+
+  big_integer a("100000000000000000000000000000000000007");
+  big_integer b("-1000000000000000000000");
+  big_integer q, r;
+  divmod(a, b, &q, &r);
+  EXPECT_EQ(a / b, q);
+  EXPECT_EQ(a % b, r);
+
+  big_integer c = b;
+  divmod(a, c, nullptr, &c);
+  EXPECT_EQ(r, c);
+  c = a;
+  divmod(c, b, &c, nullptr);
+  EXPECT_EQ(q, c);
+  c = a;
+  big_integer d = b;
+  divmod(c, d, &d, &c);
+  EXPECT_EQ(q, d);
+  EXPECT_EQ(r, c);
+
+  EXPECT_THROW(divmod(a, big_integer()), std::runtime_error);
+}
+
+TEST(correctness, scalar_operands) {
+  big_integer a("-100000000000000000000000000000000000007");
+  big_integer big_max = big_integer(std::to_string(UINT64_MAX));
+  big_integer big_min = big_integer(std::to_string(INT64_MIN));
+
+  EXPECT_EQ(a + big_max, a + UINT64_MAX);
+  EXPECT_EQ(a - big_max, a - UINT64_MAX);
+  EXPECT_EQ(a * big_max, a * UINT64_MAX);
+  EXPECT_EQ(a / big_max, a / UINT64_MAX);
+  EXPECT_EQ(a % big_max, a % UINT64_MAX);
+  EXPECT_EQ(a + big_min, a + INT64_MIN);
+  EXPECT_EQ(a - big_min, a - INT64_MIN);
+  EXPECT_EQ(a * big_min, a * INT64_MIN);
+  EXPECT_EQ(a / big_min, a / INT64_MIN);
+  EXPECT_EQ(a % big_min, a % INT64_MIN);
+  EXPECT_EQ(big_max * a, UINT64_MAX * a);
+  EXPECT_EQ(big_min + a, INT64_MIN + a);
+  EXPECT_EQ(big_max - a, UINT64_MAX - a);
+  EXPECT_EQ(big_min - a, INT64_MIN - a);
+  EXPECT_EQ(big_max - a * a, UINT64_MAX - a * a);
+  EXPECT_EQ(big_min - a * 3, INT64_MIN - a * 3);
+  EXPECT_EQ(big_max / 7, UINT64_MAX / big_integer(7));
+  EXPECT_EQ(big_min % 7, INT64_MIN % big_integer(7));
+  EXPECT_EQ(big_integer(), INT64_MIN / a);
+  EXPECT_EQ(big_max, UINT64_MAX % a);
+  EXPECT_EQ(big_min, INT64_MIN % a);
+
+  big_integer b = 5;
+  b -= 7u;
+  EXPECT_EQ(-2, b);
+  b += 2ll;
+  EXPECT_EQ(0, b);
+  EXPECT_FALSE(b < 0);
+  b -= 0;
+  EXPECT_EQ(big_integer(), b);
+  b = -7;
+  EXPECT_EQ(-3, b / 2);
+  EXPECT_EQ(3, b / -2);
+  EXPECT_EQ(-1, b % 2u);
+  EXPECT_EQ(-1, b % -2);
+  EXPECT_EQ(0, b * 0);
+  EXPECT_FALSE((b * 0) < 0);
+  EXPECT_EQ(big_integer(), -b % 7);
+  EXPECT_THROW(b / 0, std::runtime_error);
+  EXPECT_THROW(b %= 0ul, std::runtime_error);
+
+  EXPECT_TRUE(big_max == UINT64_MAX);
+  EXPECT_TRUE(big_max > INT64_MAX);
+  EXPECT_TRUE(big_min == INT64_MIN);
+  EXPECT_TRUE(big_min < -1);
+  EXPECT_TRUE(INT64_MIN <= big_min);
+  EXPECT_TRUE(0u < big_max);
+  EXPECT_TRUE(a < INT64_MIN);
+  EXPECT_TRUE(a != 0);
+  EXPECT_TRUE(big_integer() >= 0u);
+  EXPECT_TRUE(-1 < big_integer());
+}
+
+TEST(correctness, product_expression) {
+  big_integer a("18446744073709551617");
+  big_integer b = -3;
+  big_integer c = a * b;
+  EXPECT_EQ(big_integer("-55340232221128654851"), c);
+
+  c += a * 3;
+  EXPECT_EQ(0, c);
+  EXPECT_FALSE(c < 0);
+  c -= a * b;
+  EXPECT_EQ(a * 3, c);
+  c = c * b;
+  EXPECT_EQ(a * -9, c);
+  EXPECT_EQ(0, a * b - b * a);
+  EXPECT_EQ(1, a * b + 1 - b * a);
+  EXPECT_EQ(-1, -1 + a * b - a * b);
+  EXPECT_EQ(a * b * b, a * 9);
+  EXPECT_EQ(-(a * b), a * -b);
+
+  // the expression cannot be stored to be evaluated after its operands change
+  static_assert(!std::is_copy_constructible<big_integer::product_expression>::value, "");
+  static_assert(!std::is_move_constructible<big_integer::product_expression>::value, "");
+
+  // a temporary operand is not captured by reference
+  static_assert(std::is_same<decltype(big_integer(7) * a), big_integer>::value, "");
+  static_assert(std::is_same<decltype(a * big_integer(7)), big_integer>::value, "");
+  static_assert(std::is_same<decltype(a * b * b), big_integer>::value, "");
+  auto p = big_integer(7) * a;
+  big_integer d = p;
+  EXPECT_EQ(a * 7, d);
+  auto q = a * b * b;
+  EXPECT_EQ(a * 9, q);
+  EXPECT_EQ(a * -21, big_integer(7) * (a * b));
+}
+
+TEST(correctness, fused_multiply) {
+  big_integer a("18446744073709551617");
+  big_integer b = -3;
+  big_integer c;
+  c.addmul(a, b);
+  EXPECT_EQ(big_integer("-55340232221128654851"), c);
+  c.submul(a, b);
+  EXPECT_EQ(0, c);
+  EXPECT_FALSE(c < 0);
+  c.submul(a, 3).addmul(a, 5);
+  EXPECT_EQ(a * 2, c);
+  c.addmul(a, 0).submul(big_integer(), b);
+  EXPECT_EQ(a * 2, c);
+  c.submul(a, 2u);
+  EXPECT_EQ(0, c);
+  c.addmul(a, std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(a * big_integer("-9223372036854775808"), c);
+
+  // operands that are the destination
+  c = a;
+  c.addmul(c, c);
+  EXPECT_EQ(a + a * a, c);
+  c = a;
+  c.submul(c, -7);
+  EXPECT_EQ(a * 8, c);
+  c = a;
+  c.submul(a, c);
+  EXPECT_EQ(a - a * a, c);
+
+  mul(c, a, b);
+  EXPECT_EQ(a * b, c);
+  mul(c, c, c);
+  EXPECT_EQ(a * a * 9, c);
+  mul(c, a, big_integer());
+  EXPECT_EQ(0, c);
+  EXPECT_FALSE(c < 0);
+}
+
 TEST(correctness, unary_plus) {
   big_integer a = 123;
   big_integer b = +a;
@@ -612,6 +868,108 @@ TEST(correctness, mul_div_randomized) {
   }
 }
 
+TEST(correctness, limb_arena) {
+  limb_arena arena(64);
+  for (unsigned itn = 0; itn != number_of_iterations; ++itn) {
+    std::vector<int> multipliers;
+    for (size_t i = 0; i != number_of_multipliers; ++i)
+      multipliers.push_back(myrand());
+    big_integer kept;
+    std::string expected;
+    {
+      scoped_limb_allocator scope(arena);
+      EXPECT_EQ(&arena, current_limb_allocator());
+      big_integer accumulator = 1;
+      for (size_t i = 0; i != number_of_multipliers; ++i)
+        accumulator *= multipliers[i];
+      EXPECT_NE(0u, arena.allocated());
+      // a value that outlives the arena is copied out under operator new
+      set_limb_allocator(nullptr);
+      kept = accumulator;
+      set_limb_allocator(&arena);
+      expected = to_string(accumulator);
+      for (size_t i = 1; i != number_of_multipliers; ++i)
+        accumulator /= multipliers[i];
+      EXPECT_TRUE(accumulator == multipliers[0]);
+    }
+    EXPECT_EQ(nullptr, current_limb_allocator());
+    arena.release();
+    EXPECT_EQ(0u, arena.allocated());
+    EXPECT_EQ(expected, to_string(kept));
+  }
+}
+
+namespace {
+struct counting_allocator : limb_allocator {
+  void* allocate(size_t bytes) override {
+    ++allocations;
+    outstanding += bytes;
+    return operator new(bytes);
+  }
+
+  void deallocate(void* p, size_t bytes) noexcept override {
+    outstanding -= bytes;
+    operator delete(p);
+  }
+
+  size_t allocations = 0;
+  size_t outstanding = 0;
+};
+}
+
+TEST(correctness, limb_allocator) {
+  counting_allocator counting;
+  big_integer a, b;
+  {
+    scoped_limb_allocator scope(counting);
+    a = big_integer(1) << 1000;
+    b = a;
+  }
+  size_t const allocations = counting.allocations;
+  EXPECT_NE(0u, allocations);
+  EXPECT_NE(0u, counting.outstanding);
+
+  // buffers go back to the allocator they came from, whoever frees them
+  big_integer c = a * b;
+  EXPECT_EQ(allocations, counting.allocations);
+  {
+    limb_arena arena;
+    scoped_limb_allocator scope(arena);
+    big_integer d = c * a;
+    a = 0;
+    b = d >> 2000;
+    EXPECT_EQ(big_integer(1) << 1000, b);
+    b = 0;
+  }
+  EXPECT_EQ(0u, counting.outstanding);
+  EXPECT_EQ(allocations, counting.allocations);
+  EXPECT_EQ(big_integer(1) << 2000, c);
+}
+
+TEST(correctness, limb_pool) {
+  trim_limb_pool();
+  reset_limb_pool_stats();
+  big_integer a = big_integer(1) << 4000;
+  for (int i = 0; i != 100; ++i) {
+    big_integer b = a * a + i;
+    EXPECT_EQ(big_integer(i), b % a);
+  }
+  limb_pool_statistics statistics = limb_pool_stats();
+#if BIG_INTEGER_LIMB_POOL
+  // after the first round every buffer is a recycled one
+  EXPECT_GE(statistics.hits, 100u);
+  EXPECT_LE(statistics.misses, 10u);
+  EXPECT_GE(statistics.peak, 2 * 4000 / 8u);
+  EXPECT_NE(0u, statistics.cached);
+  trim_limb_pool();
+  EXPECT_EQ(0u, limb_pool_stats().cached);
+#else
+  EXPECT_EQ(0u, statistics.hits);
+  EXPECT_EQ(0u, statistics.misses);
+  EXPECT_EQ(0u, statistics.peak);
+#endif
+}
+
 namespace {
 template<typename T>
 void erase_unordered(std::vector<T>& v, typename std::vector<T>::iterator pos) {
@@ -662,6 +1020,7 @@ TEST(correctness, mul_merge_randomized) {
     big_integer b = merge_all(x);
 
     EXPECT_TRUE(a == b);
+    EXPECT_EQ(a, product(x));
   }
 }
 
@@ -744,6 +1103,242 @@ TEST(correctness_random, mul) {
   }
 }
 
+TEST(correctness_random, product_expressions) {
+  std::default_random_engine rng(42);
+  for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+    size_t sizes[] = {max_size / 16, max_size, 8 * max_size};
+    big_integer_gmp a, b, c, d, e;
+    a.random(sizes[itn % 3], rng);
+    b.random(sizes[itn / 3 % 3], rng);
+    c.random(sizes[itn / 9 % 3], rng);
+    d.random(max_size, rng);
+    e.random(2 * max_size, rng);
+    big_integer A(to_string(a)), B(to_string(b)), C(to_string(c)), D(to_string(d)), E(to_string(e));
+
+    EXPECT_EQ(to_string(a * b + c), to_string(A * B + C));
+    EXPECT_EQ(to_string(c + a * b), to_string(C + A * B));
+    EXPECT_EQ(to_string(a * b - c), to_string(A * B - C));
+    EXPECT_EQ(to_string(c - a * b), to_string(C - A * B));
+    EXPECT_EQ(to_string(a * b + c * d - e), to_string(A * B + C * D - E));
+    EXPECT_EQ(to_string(a * b - c * d), to_string(A * B - C * D));
+    EXPECT_EQ(to_string(-(a * b)), to_string(-(A * B)));
+
+    big_integer_gmp x = c;
+    big_integer X = C;
+    x += a * b;
+    X += A * B;
+    EXPECT_EQ(to_string(x), to_string(X));
+    x -= x * b;
+    X -= X * B;
+    EXPECT_EQ(to_string(x), to_string(X));
+    x += a * x;
+    X += A * X;
+    EXPECT_EQ(to_string(x), to_string(X));
+    x -= x * x;
+    X -= X * X;
+    EXPECT_EQ(to_string(x), to_string(X));
+    X -= A * B;
+    X += A * B;
+    EXPECT_EQ(to_string(x), to_string(X));
+  }
+}
+
+TEST(correctness_random, fused_multiply) {
+  std::default_random_engine rng(42);
+  for (size_t itn = 0; itn != 3 * number_of_iterations; ++itn) {
+    size_t sizes[] = {max_size / 16, max_size, 8 * max_size};
+    big_integer_gmp a, b, x;
+    a.random(sizes[itn % 3], rng);
+    b.random(sizes[itn / 3 % 3], rng);
+    x.random(sizes[itn / 9 % 3], rng);
+    big_integer A(to_string(a)), B(to_string(b)), X(to_string(x));
+
+    x.addmul(a, b);
+    X.addmul(A, B);
+    EXPECT_EQ(to_string(x), to_string(X));
+    x.submul(b, a);
+    X.submul(B, A);
+    EXPECT_EQ(to_string(x), to_string(X));
+    // products that nearly cancel the accumulator
+    x.submul(a, b);
+    X.submul(A, B);
+    EXPECT_EQ(to_string(x), to_string(X));
+    x.addmul(a, b);
+    X.addmul(A, B);
+    EXPECT_EQ(to_string(x), to_string(X));
+    x.submul(x, b);
+    X.submul(X, B);
+    EXPECT_EQ(to_string(x), to_string(X));
+    x.addmul(a, -12345);
+    X.addmul(A, -12345);
+    EXPECT_EQ(to_string(x), to_string(X));
+    mul(x, x, a);
+    mul(X, X, A);
+    EXPECT_EQ(to_string(x), to_string(X));
+    mul(x, a, b);
+    mul(X, A, B);
+    EXPECT_EQ(to_string(x), to_string(X));
+  }
+}
+
+TEST(correctness_random, mul_large) {
+  std::default_random_engine rng(7);
+  size_t const sizes[] = {3000, 9000, 30000};
+  for (size_t a_size : sizes) {
+    for (size_t b_size : sizes) {
+      big_integer_gmp a, b;
+      a.random(a_size, rng);
+      b.random(b_size, rng);
+      big_integer_gmp c = a * b;
+      big_integer R = big_integer(to_string(a)) * big_integer(to_string(b));
+      EXPECT_EQ(to_string(c), to_string(R));
+    }
+  }
+}
+
+// every implementation the processor supports against the portable one; the
+// whole suite runs on a single one, chosen by BIG_INTEGER_KERNELS
+TEST(correctness_random, kernel_implementations) {
+  std::mt19937_64 rng(16);
+  typedef std::vector<kernels::limb_t> limbs;
+  // mostly all-ones limbs, so that the carries run through
+  auto random_limbs = [&](size_t n) {
+    limbs x(n);
+    for (kernels::limb_t& limb : x)
+      limb = rng() % 4 != 0 ? ~kernels::limb_t(0) : rng();
+    return x;
+  };
+  kernels::implementation const& reference = kernels::implementations[0];
+  for (size_t k = 1; k != kernels::implementation_count; ++k) {
+    kernels::implementation const& impl = kernels::implementations[k];
+    if (!impl.supported())
+      continue;
+    SCOPED_TRACE(impl.name);
+    for (size_t n = 0; n != 40; ++n) {
+      for (int itn = 0; itn != 20; ++itn) {
+        limbs a = random_limbs(n), b = random_limbs(n), r = random_limbs(n);
+        kernels::limb_t m = itn % 2 == 0 ? ~kernels::limb_t(0) : rng();
+        limbs expected(n), actual(n);
+        EXPECT_EQ(reference.add_n(expected.data(), a.data(), b.data(), n), impl.add_n(actual.data(), a.data(), b.data(), n));
+        EXPECT_EQ(expected, actual);
+        EXPECT_EQ(reference.sub_n(expected.data(), a.data(), b.data(), n), impl.sub_n(actual.data(), a.data(), b.data(), n));
+        EXPECT_EQ(expected, actual);
+        EXPECT_EQ(reference.mul_1(expected.data(), a.data(), n, m), impl.mul_1(actual.data(), a.data(), n, m));
+        EXPECT_EQ(expected, actual);
+        expected = actual = r;
+        EXPECT_EQ(reference.addmul_1(expected.data(), a.data(), n, m), impl.addmul_1(actual.data(), a.data(), n, m));
+        EXPECT_EQ(expected, actual);
+        if (n != 0) {
+          limbs product(2 * n), other_product(2 * n);
+          reference.mul_basecase(product.data(), a.data(), n, b.data(), n);
+          impl.mul_basecase(other_product.data(), a.data(), n, b.data(), n);
+          EXPECT_EQ(product, other_product);
+        }
+      }
+    }
+    if (impl.mul_radix52 == nullptr)
+      continue;
+    size_t const sizes[] = {1, 2, 3, 7, 13, 16, 17, 40, 95, 200};
+    for (size_t an : sizes) {
+      for (size_t bn : sizes) {
+        if (bn > an)
+          continue;
+        limbs a = random_limbs(an), b = random_limbs(bn);
+        limbs product(an + bn), other_product(an + bn);
+        limbs scratch(kernels::radix52_scratch_size(an, bn));
+        reference.mul_basecase(product.data(), a.data(), an, b.data(), bn);
+        impl.mul_radix52(other_product.data(), a.data(), an, b.data(), bn, scratch.data());
+        EXPECT_EQ(product, other_product) << an << " x " << bn;
+      }
+    }
+  }
+}
+
+TEST(correctness, select_implementation) {
+  std::string const active = kernels::active_implementation().name;
+  EXPECT_FALSE(kernels::select_implementation("no such kernels"));
+  EXPECT_EQ(active, kernels::active_implementation().name);
+  EXPECT_TRUE(kernels::select_implementation("portable"));
+  EXPECT_EQ(big_integer("340282366920938463463374607431768211456"),
+            big_integer("18446744073709551616") * big_integer("18446744073709551616"));
+  EXPECT_TRUE(kernels::select_implementation(active.c_str()));
+}
+
+TEST(correctness_random, mul_fft) {
+  std::default_random_engine rng(11);
+  size_t const fft_threshold = kernels::fft_threshold;
+  kernels::fft_threshold = 1;
+  size_t const sizes[] = {100, 1000, 10000, 100000};
+  for (size_t a_size : sizes) {
+    for (size_t b_size : sizes) {
+      big_integer_gmp a, b;
+      a.random(a_size, rng);
+      b.random(b_size, rng);
+      big_integer_gmp c = a * b;
+      big_integer R = big_integer(to_string(a)) * big_integer(to_string(b));
+      EXPECT_EQ(big_integer(to_string(c)), R);
+    }
+  }
+  kernels::fft_threshold = fft_threshold;
+
+  for (size_t size = 250000; size <= 1000000; size *= 2) {
+    big_integer_gmp a, b;
+    a.random(size, rng);
+    b.random(size, rng);
+    big_integer_gmp c = a * b;
+    big_integer A(to_string(a));
+    big_integer R = A * big_integer(to_string(b));
+    EXPECT_EQ(big_integer(to_string(c)), R);
+    c = a * a;
+    EXPECT_EQ(big_integer(to_string(c)), A * A);
+  }
+}
+
+// the Toom-3, Karatsuba and NTT products forked at every level, on more
+// threads than the serial sizes would ever start
+TEST(correctness_random, mul_parallel) {
+  std::default_random_engine rng(19);
+  size_t const threads = kernels::thread_count();
+  size_t const parallel_threshold = kernels::parallel_threshold;
+  size_t const fft_threshold = kernels::fft_threshold;
+  kernels::set_thread_count(4);
+  kernels::parallel_threshold = 1;
+  size_t const sizes[] = {5000, 40000, 200000};
+  for (size_t fft : {fft_threshold, size_t(1)}) {
+    kernels::fft_threshold = fft;
+    for (size_t a_size : sizes) {
+      for (size_t b_size : sizes) {
+        big_integer_gmp a, b;
+        a.random(a_size, rng);
+        b.random(b_size, rng);
+        big_integer_gmp c = a * b;
+        big_integer R = big_integer(to_string(a)) * big_integer(to_string(b));
+        EXPECT_EQ(big_integer(to_string(c)), R);
+      }
+    }
+  }
+  kernels::fft_threshold = fft_threshold;
+  kernels::parallel_threshold = parallel_threshold;
+  kernels::set_thread_count(threads);
+}
+
+TEST(correctness, fork_join) {
+  size_t const threads = kernels::thread_count();
+  for (size_t count : {1, 3}) {
+    kernels::set_thread_count(count);
+    std::vector<int> done(100);
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i != done.size(); ++i)
+      tasks.push_back([&done, i] { ++done[i]; });
+    kernels::fork_join(tasks.data(), tasks.size());
+    EXPECT_EQ(std::vector<int>(100, 1), done);
+
+    tasks[50] = [] { throw std::runtime_error("task"); };
+    EXPECT_THROW(kernels::fork_join(tasks.data(), tasks.size()), std::runtime_error);
+  }
+  kernels::set_thread_count(threads);
+}
+
 TEST(correctness_random, div) {
   std::default_random_engine rng(322);
   for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -776,6 +1371,53 @@ TEST(correctness_random, mod) {
   }
 }
 
+namespace {
+void check_div(big_integer_gmp const& a, big_integer_gmp const& b) {
+  big_integer A(to_string(a));
+  big_integer B(to_string(b));
+  std::pair<big_integer_gmp, big_integer_gmp> expected = divmod(a, b);
+  std::pair<big_integer, big_integer> qr = divmod(A, B);
+  EXPECT_EQ(big_integer(to_string(expected.first)), qr.first);
+  EXPECT_EQ(big_integer(to_string(expected.second)), qr.second);
+  EXPECT_EQ(qr.first, A / B);
+  EXPECT_EQ(qr.second, A % B);
+}
+}
+
+TEST(correctness_random, div_large) {
+  std::default_random_engine rng(17);
+  size_t const dc_div_threshold = kernels::dc_div_threshold;
+  size_t const newton_div_threshold = kernels::newton_div_threshold;
+  kernels::dc_div_threshold = 4;
+  kernels::newton_div_threshold = 8;
+  size_t const sizes[] = {200, 1000, 5000, 20000, 60000};
+  for (size_t a_size : sizes) {
+    for (size_t b_size : sizes) {
+      big_integer_gmp a, b;
+      a.random(a_size, rng);
+      b.random(b_size, rng);
+      if (b == 0)
+        b = 1;
+      check_div(a, b);
+      check_div(-a, b);
+
+      big_integer_gmp power = big_integer_gmp(1) << static_cast<int>(b_size);
+      check_div(a, power);
+      check_div(a, power - 1);
+      check_div(power * power - 1, power - 1);
+    }
+  }
+  kernels::dc_div_threshold = dc_div_threshold;
+  kernels::newton_div_threshold = newton_div_threshold;
+
+  for (size_t size = 50000; size <= 800000; size *= 4) {
+    big_integer_gmp a, b;
+    a.random(2 * size, rng);
+    b.random(size, rng);
+    check_div(a, b);
+  }
+}
+
 TEST(correctness_random, bitwise) {
   std::default_random_engine rng(42);
   for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -809,6 +1451,437 @@ TEST(correctness_random, bit_shifts) {
   }
 }
 
+TEST(correctness_random, string_conv_large) {
+  std::default_random_engine rng(19);
+  for (size_t size = max_size; size <= 1000 * max_size; size *= 10) {
+    big_integer_gmp a;
+    a.random(size, rng);
+    std::string s = to_string(a);
+    big_integer R(s);
+    EXPECT_EQ(s, to_string(R));
+    EXPECT_EQ(to_string(a * 3 + 1), to_string(R * 3 + 1));
+    std::string zeros(24, '0');
+    EXPECT_EQ(R, big_integer(s[0] == '-' ? "-" + zeros + s.substr(1) : zeros + s));
+  }
+
+  // digit counts around the split points 19 * 2^k
+  for (size_t digits = 600; digits <= 20000; digits = digits * 3 / 2) {
+    std::string nines(digits, '9');
+    big_integer R(nines);
+    EXPECT_EQ(nines, to_string(R));
+    EXPECT_EQ("1" + std::string(digits, '0'), to_string(R + 1));
+    EXPECT_EQ("-" + nines, to_string(-R));
+  }
+  for (size_t k = 5; k <= 10; ++k) {
+    std::string power = "1" + std::string(19 << k, '0');
+    EXPECT_EQ(power, to_string(big_integer(power)));
+    EXPECT_EQ(power, to_string(big_integer(power) - 1 + 1));
+  }
+}
+
+namespace {
+typedef fixed_big_integer<256> int256;
+typedef fixed_big_integer<256, false> uint256;
+typedef fixed_big_integer<512> int512;
+typedef fixed_big_integer<512, false> uint512;
+
+constexpr uint512 factorial(unsigned n) {
+  uint512 r = 1;
+  for (unsigned i = 2; i <= n; ++i)
+    r *= i;
+  return r;
+}
+
+template<typename F>
+void check_fixed(F const& a, F const& b) {
+  big_integer A = static_cast<big_integer>(a);
+  big_integer B = static_cast<big_integer>(b);
+  EXPECT_EQ(a + b, F(A + B));
+  EXPECT_EQ(a - b, F(A - B));
+  EXPECT_EQ(a * b, F(A * B));
+  EXPECT_EQ(a & b, F(A & B));
+  EXPECT_EQ(a | b, F(A | B));
+  EXPECT_EQ(a ^ b, F(A ^ B));
+  EXPECT_EQ(-a, F(-A));
+  EXPECT_EQ(~a, F(~A));
+  EXPECT_EQ(a < b, A < B);
+  EXPECT_EQ(a == b, A == B);
+  if (b != 0) {
+    EXPECT_EQ(a / b, F(A / B));
+    EXPECT_EQ(a % b, F(A % B));
+  }
+  int shift = static_cast<int>(to_string(A).size() * 3 % 300);
+  EXPECT_EQ(a << shift, F(A << shift));
+  EXPECT_EQ(a >> shift, F(A >> shift));
+  EXPECT_EQ(to_string(A), to_string(a));
+  EXPECT_EQ(a, F(to_string(a)));
+}
+
+template<typename F>
+void check_fixed_random(size_t bits) {
+  std::default_random_engine rng(42);
+  for (size_t itn = 0; itn != 100 * number_of_iterations; ++itn) {
+    big_integer_gmp a, b;
+    a.random(1 + itn * 7 % bits, rng);
+    b.random(1 + itn * 13 % bits, rng);
+    check_fixed(F(big_integer(to_string(a))), F(big_integer(to_string(b))));
+  }
+}
+}
+
+TEST(correctness, fixed_width) {
+  static_assert(int256(-7) / 2 == -3, "");
+  static_assert(int256(-7) % 2 == -1, "");
+  static_assert(int256(-7) >> 1 == -4, "");
+  static_assert(int256(-1) >> 300 == -1, "");
+  static_assert(uint256(0) - 1 == ~uint256(0), "");
+  static_assert(uint256(0) - 1 > uint256(1) << 255, "");
+  static_assert(int256(1) << 255 < int256(0) - 1, "");
+  static_assert((uint256(1) << 255) * 2 == 0, "");
+  static_assert(factorial(60) / factorial(58) == 60 * 59, "");
+  static_assert(factorial(60) % (factorial(30) + 1) == factorial(60) - factorial(60) / (factorial(30) + 1) * (factorial(30) + 1), "");
+
+  EXPECT_EQ("-57896044618658097711785492504343953926634992332820282019728792003956564819968",
+            to_string(int256(1) << 255));
+  EXPECT_EQ("115792089237316195423570985008687907853269984665640564039457584007913129639935",
+            to_string(uint256(-1)));
+  EXPECT_EQ(to_string(factorial(98)),
+            to_string(static_cast<big_integer>(factorial(97)) * 98));
+  EXPECT_EQ(uint256(-1), uint256(big_integer(-1)));
+  EXPECT_EQ(int256(1), int256(big_integer("-115792089237316195423570985008687907853269984665640564039457584007913129639935")));
+  EXPECT_EQ(int256(-12), int256("-12"));
+  EXPECT_THROW(int256("12a"), std::runtime_error);
+  EXPECT_THROW(int256(1) / 0, std::runtime_error);
+
+  int256 x = 5;
+  EXPECT_EQ(5, x++);
+  EXPECT_EQ(5, --x);
+  x -= 6;
+  EXPECT_EQ(-1, x);
+  EXPECT_EQ(big_integer(-1), static_cast<big_integer>(x));
+}
+
+TEST(correctness_random, fixed_width) {
+  check_fixed_random<int256>(250);
+  check_fixed_random<uint256>(256);
+  check_fixed_random<int512>(500);
+  check_fixed_random<uint512>(600);
+}
+
+TEST(correctness, montgomery) {
+  montgomery_context ctx(big_integer(97));
+  EXPECT_EQ(97, ctx.modulus());
+  big_integer a = ctx.to_montgomery(-5);
+  big_integer b = ctx.to_montgomery(1000);
+  EXPECT_EQ(-5000 % 97 + 97, ctx.from_montgomery(ctx.mulmod(a, b)));
+  EXPECT_EQ(25, ctx.from_montgomery(ctx.sqrmod(a)));
+  EXPECT_EQ(0, ctx.mulmod(a, ctx.to_montgomery(97)));
+  EXPECT_EQ(0, ctx.from_montgomery(0));
+
+  montgomery_context one(1);
+  EXPECT_EQ(0, one.from_montgomery(one.mulmod(one.to_montgomery(5), one.to_montgomery(7))));
+
+  EXPECT_THROW(montgomery_context(big_integer(100)), std::runtime_error);
+  EXPECT_THROW(montgomery_context(big_integer(-97)), std::runtime_error);
+  EXPECT_THROW(montgomery_context(big_integer(0)), std::runtime_error);
+}
+
+TEST(correctness_random, montgomery) {
+  std::default_random_engine rng(42);
+  for (size_t bits : {64, 127, 128, 1000, 4096, 20000}) {
+    for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+      big_integer_gmp m;
+      m.random(bits, rng);
+      big_integer M(to_string(m));
+      if (M < 0)
+        M = -M;
+      M |= 1;
+      montgomery_context ctx(M);
+
+      big_integer_gmp a, b;
+      a.random(bits + itn * 30, rng);
+      b.random(bits / 2 + 1, rng);
+      big_integer A(to_string(a)), B(to_string(b));
+      big_integer x = ctx.to_montgomery(A);
+      big_integer y = ctx.to_montgomery(B);
+      EXPECT_TRUE(x >= 0 && x < M);
+      EXPECT_EQ(((A % M + M) % M), ctx.from_montgomery(x));
+
+      big_integer expected = (A * B) % M;
+      if (expected < 0)
+        expected += M;
+      EXPECT_EQ(expected, ctx.from_montgomery(ctx.mulmod(x, y)));
+      expected = A * A % M;
+      EXPECT_EQ(expected, ctx.from_montgomery(ctx.sqrmod(x)));
+
+      big_integer top = ctx.to_montgomery(M - 1);
+      EXPECT_EQ(1, ctx.from_montgomery(ctx.sqrmod(top)));
+    }
+  }
+}
+
+TEST(correctness, powmod) {
+  EXPECT_EQ(24, powmod(big_integer(2), 10, 1000));
+  EXPECT_EQ(23, powmod_ct(big_integer(2), 10, 1001));
+  EXPECT_EQ(6, powmod(big_integer(-2), 3, 7));
+  EXPECT_EQ(6, powmod_ct(big_integer(-2), 3, 7));
+  EXPECT_EQ(1, powmod(big_integer(3), 0, 7));
+  EXPECT_EQ(1, powmod_ct(big_integer(3), 0, 7));
+  EXPECT_EQ(0, powmod(big_integer(3), 0, 1));
+  EXPECT_EQ(0, powmod_ct(big_integer(3), 0, 1));
+  EXPECT_EQ(0, powmod(big_integer(0), 5, 7));
+  EXPECT_EQ(1, powmod(big_integer(3), 256, 1024));
+  EXPECT_EQ(big_integer("1267650600228229401496703205376"), powmod(big_integer(2), 100, big_integer("100000000000000000000000000000001")));
+
+  EXPECT_THROW(powmod(big_integer(2), 3, 0), std::runtime_error);
+  EXPECT_THROW(powmod(big_integer(2), 3, -7), std::runtime_error);
+  EXPECT_THROW(powmod(big_integer(2), -3, 7), std::runtime_error);
+  EXPECT_THROW(powmod(big_integer(2), -3, 8), std::runtime_error);
+  EXPECT_THROW(powmod_ct(big_integer(2), -3, 7), std::runtime_error);
+  EXPECT_THROW(powmod_ct(big_integer(2), 3, 8), std::runtime_error);
+}
+
+// the products of powmod_ct never take the recursive algorithms, whose
+// branches and normalization depend on the limbs
+TEST(correctness, powmod_ct_schedule) {
+  big_integer m = (big_integer(1) << 4095) + 12345;
+  montgomery_context ctx(m);
+  big_integer x = ctx.to_montgomery(big_integer(3) << 3000);
+  big_integer e = (big_integer(1) << 4000) - 3;
+
+  size_t before = kernels::recursive_products();
+  big_integer r = ctx.powmod_ct(x, e);
+  EXPECT_EQ(before, kernels::recursive_products());
+
+  before = kernels::recursive_products();
+  big_integer s = ctx.powmod(x, e);
+  // where powmod has them take Karatsuba, which the counter must see
+  if (kernels::active_implementation().mul_radix52 == nullptr &&
+      4096 / kernels::limb_bits >= kernels::karatsuba_threshold) {
+    EXPECT_LT(before, kernels::recursive_products());
+  }
+  EXPECT_EQ(s, r);
+}
+
+TEST(correctness_random, powmod) {
+  std::default_random_engine rng(42);
+  for (size_t bits : {64, 200, 1000, 2048}) {
+    for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+      big_integer_gmp m, b, e;
+      m.random(bits, rng);
+      b.random(bits + 100, rng);
+      e.random(itn * bits / 4 + 1, rng);
+      if (m < 0)
+        m = -m;
+      if (e < 0)
+        e = -e;
+      if (m == 0)
+        m = 1;
+      big_integer_gmp even = m * 2;
+      if (m % 2 == 0)
+        m += 1;
+
+      big_integer M(to_string(m)), B(to_string(b)), E(to_string(e)), Even(to_string(even));
+      std::string expected = to_string(powmod(b, e, m));
+      EXPECT_EQ(expected, to_string(powmod(B, E, M)));
+      EXPECT_EQ(expected, to_string(powmod_ct(B, E, M)));
+      EXPECT_EQ(to_string(powmod(b, e, even)), to_string(powmod(B, E, Even)));
+    }
+  }
+}
+
+TEST(correctness, gcd) {
+  EXPECT_EQ(6, gcd(big_integer(12), 18));
+  EXPECT_EQ(6, gcd(big_integer(-12), -18));
+  EXPECT_EQ(5, gcd(big_integer(0), -5));
+  EXPECT_EQ(0, gcd(big_integer(0), 0));
+  EXPECT_EQ(12, lcm(big_integer(-4), 6));
+  EXPECT_EQ(0, lcm(big_integer(0), 6));
+
+  big_integer s, t;
+  EXPECT_EQ(2, gcdext(big_integer(240), 46, &s, &t));
+  EXPECT_EQ(-9, s);
+  EXPECT_EQ(47, t);
+  EXPECT_EQ(7, gcdext(big_integer(-7), 0, &s, &t));
+  EXPECT_EQ(-1, s);
+  EXPECT_EQ(0, t);
+  EXPECT_EQ(7, gcdext(big_integer(7), -7, &s, &t));
+  EXPECT_EQ(0, s);
+  EXPECT_EQ(-1, t);
+
+  big_integer f0 = 0, f1 = 1;
+  for (int i = 0; i != 2000; ++i) {
+    f0 += f1;
+    std::swap(f0, f1);
+  }
+  EXPECT_EQ(1, gcd(f1, f0));
+  EXPECT_EQ(f0, gcd(f1 * f0, f0 * f0));
+
+  EXPECT_EQ(4, modinv(big_integer(3), 11));
+  EXPECT_EQ(7, modinv(big_integer(-3), 11));
+  EXPECT_EQ(0, modinv(big_integer(5), 1));
+  EXPECT_THROW(modinv(big_integer(2), 4), std::runtime_error);
+  EXPECT_THROW(modinv(big_integer(3), 0), std::runtime_error);
+  EXPECT_THROW(modinv(big_integer(3), -11), std::runtime_error);
+}
+
+namespace {
+void check_gcd(big_integer_gmp const& a, big_integer_gmp const& b) {
+  big_integer A(to_string(a)), B(to_string(b));
+  big_integer_gmp s, t;
+  big_integer S, T;
+  EXPECT_EQ(to_string(gcd(a, b)), to_string(gcd(A, B)));
+  EXPECT_EQ(to_string(gcdext(a, b, &s, &t)), to_string(gcdext(A, B, &S, &T)));
+  EXPECT_EQ(to_string(s), to_string(S));
+  EXPECT_EQ(to_string(t), to_string(T));
+  EXPECT_EQ(to_string(lcm(a, b)), to_string(lcm(A, B)));
+  if (b > 0 && gcd(a, b) == 1) {
+    EXPECT_EQ(to_string(modinv(a, b)), to_string(modinv(A, B)));
+  }
+}
+}
+
+TEST(correctness_random, gcd) {
+  std::default_random_engine rng(14);
+  size_t const hgcd_threshold = kernels::hgcd_threshold;
+  for (size_t threshold : {hgcd_threshold, size_t(2), size_t(5)}) {
+    kernels::hgcd_threshold = threshold;
+    for (size_t bits : {10, 64, 100, 500, 3000, 8000}) {
+      for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+        big_integer_gmp a, b, c;
+        a.random(bits, rng);
+        b.random(bits * (itn % 3 + 1) / 2 + 1, rng);
+        c.random(bits / 2 + 1, rng);
+        check_gcd(a, b);
+        check_gcd(b, a);
+        check_gcd(a * c, b * c);
+        check_gcd(a * b + 1, b);
+        check_gcd(a, (big_integer_gmp(1) << static_cast<int>(bits)) * a + c);
+      }
+    }
+  }
+  kernels::hgcd_threshold = hgcd_threshold;
+
+  // all quotients 1, the longest remainder sequence for the size
+  big_integer_gmp f0 = 0, f1 = 1;
+  for (int i = 0; i != 30000; ++i) {
+    f0 += f1;
+    std::swap(f0, f1);
+  }
+  check_gcd(f1, f0);
+  check_gcd(f1 * 3, f0 * 3);
+}
+
+TEST(correctness, roots) {
+  EXPECT_EQ(0, isqrt(big_integer(0)));
+  EXPECT_EQ(1, isqrt(big_integer(3)));
+  EXPECT_EQ(2, isqrt(big_integer(4)));
+  EXPECT_EQ(4294967295u, isqrt(big_integer("18446744073709551615")));
+  EXPECT_EQ(big_integer("4294967296"), isqrt(big_integer("18446744073709551616")));
+  big_integer t("1000000000000000000000");
+  EXPECT_EQ(t, isqrt(t * t + t * 2));
+  EXPECT_EQ(t + 1, isqrt(t * t + t * 2 + 1));
+  EXPECT_THROW(isqrt(big_integer(-1)), std::runtime_error);
+
+  EXPECT_EQ(2, iroot(big_integer(26), 3));
+  EXPECT_EQ(3, iroot(big_integer(27), 3));
+  EXPECT_EQ(-3, iroot(big_integer(-27), 3));
+  EXPECT_EQ(-2, iroot(big_integer(-26), 3));
+  EXPECT_EQ(1, iroot(big_integer(5), 100));
+  EXPECT_EQ(-7, iroot(big_integer(-7), 1));
+  EXPECT_EQ(big_integer(1) << 100, iroot(big_integer(1) << 700, 7));
+  EXPECT_EQ((big_integer(1) << 100) - 1, iroot((big_integer(1) << 700) - 1, 7));
+  EXPECT_THROW(iroot(big_integer(8), 0), std::runtime_error);
+  EXPECT_THROW(iroot(big_integer(-16), 4), std::runtime_error);
+
+  EXPECT_TRUE(is_perfect_square(big_integer(0)));
+  EXPECT_TRUE(is_perfect_square(big_integer(1)));
+  EXPECT_FALSE(is_perfect_square(big_integer(2)));
+  EXPECT_FALSE(is_perfect_square(big_integer(-4)));
+  big_integer a("123456789012345678901234567890");
+  EXPECT_TRUE(is_perfect_square(a * a));
+  EXPECT_FALSE(is_perfect_square(a * a + 1));
+  EXPECT_FALSE(is_perfect_square(a * a - 1));
+}
+
+TEST(correctness_random, roots) {
+  std::default_random_engine rng(15);
+  for (size_t bits : {10, 64, 65, 128, 500, 3000, 20000}) {
+    for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+      big_integer_gmp a;
+      a.random(bits, rng);
+      if (a < 0) {
+        a = -a;
+      }
+      a = a + 1;
+      big_integer_gmp square = a * a;
+      for (big_integer_gmp const& x : {a, square - 1, square, square + a * 2}) {
+        big_integer b(to_string(x));
+        EXPECT_EQ(to_string(isqrt(x)), to_string(isqrt(b)));
+        EXPECT_EQ(is_perfect_square(x), is_perfect_square(b));
+      }
+      for (unsigned k : {3u, 4u, 5u, 17u, 100u}) {
+        big_integer_gmp root;
+        root.random(bits / k + 1, rng);
+        root = (root < 0 ? -root : root) + 1;
+        big_integer_gmp power = root;
+        for (unsigned i = 1; i != k; ++i) {
+          power *= root;
+        }
+        for (big_integer_gmp const& x : {a, power - 1, power, power + 1}) {
+          big_integer b(to_string(x));
+          EXPECT_EQ(to_string(iroot(x, k)), to_string(iroot(b, k)));
+          if (k % 2 == 1) {
+            EXPECT_EQ(to_string(iroot(-x, k)), to_string(iroot(-b, k)));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(correctness, product) {
+  std::vector<big_integer> factors;
+  EXPECT_EQ(1, product(factors));
+  factors.push_back(-7);
+  EXPECT_EQ(-7, product(factors));
+  for (int i = 2; i <= 30; ++i)
+    factors.push_back(i);
+  EXPECT_EQ(big_integer("-1856770018685337410454159360000000"), product(factors));
+  EXPECT_EQ(big_integer("-1856770018685337410454159360000000"), product(factors.begin(), factors.end()));
+  factors.push_back(0);
+  EXPECT_EQ(0, product(factors));
+
+  int const values[] = {-1, -2, -3};
+  EXPECT_EQ(-6, product(std::begin(values), std::end(values)));
+}
+
+// against a single accumulator, for factors of mixed sizes and signs, on one
+// thread and with every level split between four
+TEST(correctness_random, product) {
+  std::default_random_engine rng(20);
+  size_t const threads = kernels::thread_count();
+  size_t const parallel_threshold = kernels::parallel_threshold;
+  for (size_t count : {2, 3, 17, 100, 1000}) {
+    std::vector<big_integer_gmp> x(count);
+    std::vector<big_integer> y;
+    big_integer_gmp expected = 1;
+    for (big_integer_gmp& factor : x) {
+      factor.random(rng() % 2 == 0 ? 64 : rng() % 5000 + 1, rng);
+      if (factor == 0)
+        factor = 1;
+      expected *= factor;
+      y.emplace_back(to_string(factor));
+    }
+    EXPECT_EQ(big_integer(to_string(expected)), product(y));
+    kernels::set_thread_count(4);
+    kernels::parallel_threshold = 1;
+    EXPECT_EQ(big_integer(to_string(expected)), product(y));
+    kernels::parallel_threshold = parallel_threshold;
+    kernels::set_thread_count(threads);
+  }
+}
+
 // TODO: extend due to idea
 TEST(correctness_twos_complement, simple) {
   std::string a = "-36893488147419103232"; // -(1 << 65)
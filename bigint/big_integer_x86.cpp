@@ -0,0 +1,251 @@
+#include "big_integer_kernels.h"
+
+// Limb loops for x86-64 processors with BMI2 and ADX. mulx multiplies without
+// touching the flags, so the products can be summed on two independent carry
+// chains, adcx through CF and adox through OF; additions run an unrolled adc
+// chain. The loops count an index up to zero with lea and leave by jrcxz,
+// neither of which touches the flags, so the carries stay in CF and OF from one
+// iteration to the next. They take four limbs per iteration, and the n % 4
+// limbs at the bottom go to the portable loops first.
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#define BIG_INTEGER_X86_ADX 1
+#else
+#define BIG_INTEGER_X86_ADX 0
+#endif
+
+namespace kernels
+{
+namespace x86_adx
+{
+#if BIG_INTEGER_X86_ADX
+
+bool supported()
+{
+    static bool const result = []
+    {
+        unsigned eax, ebx, ecx, edx;
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return false;
+        }
+        unsigned const bmi2 = 1u << 8;
+        unsigned const adx = 1u << 19;
+        return (ebx & bmi2) != 0 && (ebx & adx) != 0;
+    }();
+    return result;
+}
+
+limb_t add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    size_t head = n % 4;
+    limb_t carry = portable::add_n(r, a, b, head);
+    if (n == head)
+    {
+        return carry;
+    }
+    r += n;
+    a += n;
+    b += n;
+    size_t i = head - n;
+    limb_t t0, t1;
+    __asm__ volatile(
+        "neg %[carry]\n\t"
+        "1:\n\t"
+        "mov (%[a],%[i],8), %[t0]\n\t"
+        "mov 8(%[a],%[i],8), %[t1]\n\t"
+        "adc (%[b],%[i],8), %[t0]\n\t"
+        "adc 8(%[b],%[i],8), %[t1]\n\t"
+        "mov %[t0], (%[r],%[i],8)\n\t"
+        "mov %[t1], 8(%[r],%[i],8)\n\t"
+        "mov 16(%[a],%[i],8), %[t0]\n\t"
+        "mov 24(%[a],%[i],8), %[t1]\n\t"
+        "adc 16(%[b],%[i],8), %[t0]\n\t"
+        "adc 24(%[b],%[i],8), %[t1]\n\t"
+        "mov %[t0], 16(%[r],%[i],8)\n\t"
+        "mov %[t1], 24(%[r],%[i],8)\n\t"
+        "lea 4(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %[carry]\n\t"
+        "adc $0, %[carry]"
+        : [carry] "+&r"(carry), [i] "+&c"(i), [t0] "=&r"(t0), [t1] "=&r"(t1)
+        : [r] "r"(r), [a] "r"(a), [b] "r"(b)
+        : "cc", "memory");
+    return carry;
+}
+
+limb_t sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    size_t head = n % 4;
+    limb_t borrow = portable::sub_n(r, a, b, head);
+    if (n == head)
+    {
+        return borrow;
+    }
+    r += n;
+    a += n;
+    b += n;
+    size_t i = head - n;
+    limb_t t0, t1;
+    __asm__ volatile(
+        "neg %[borrow]\n\t"
+        "1:\n\t"
+        "mov (%[a],%[i],8), %[t0]\n\t"
+        "mov 8(%[a],%[i],8), %[t1]\n\t"
+        "sbb (%[b],%[i],8), %[t0]\n\t"
+        "sbb 8(%[b],%[i],8), %[t1]\n\t"
+        "mov %[t0], (%[r],%[i],8)\n\t"
+        "mov %[t1], 8(%[r],%[i],8)\n\t"
+        "mov 16(%[a],%[i],8), %[t0]\n\t"
+        "mov 24(%[a],%[i],8), %[t1]\n\t"
+        "sbb 16(%[b],%[i],8), %[t0]\n\t"
+        "sbb 24(%[b],%[i],8), %[t1]\n\t"
+        "mov %[t0], 16(%[r],%[i],8)\n\t"
+        "mov %[t1], 24(%[r],%[i],8)\n\t"
+        "lea 4(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %[borrow]\n\t"
+        "adc $0, %[borrow]"
+        : [borrow] "+&r"(borrow), [i] "+&c"(i), [t0] "=&r"(t0), [t1] "=&r"(t1)
+        : [r] "r"(r), [a] "r"(a), [b] "r"(b)
+        : "cc", "memory");
+    return borrow;
+}
+
+// the high limb of each product goes into the next one on the CF chain
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    size_t head = n % 4;
+    limb_t carry = portable::mul_1(r, a, head, b);
+    if (n == head)
+    {
+        return carry;
+    }
+    r += n;
+    a += n;
+    size_t i = head - n;
+    limb_t lo0, hi0, lo1, hi1;
+    __asm__ volatile(
+        "xor %k[lo0], %k[lo0]\n\t"
+        "1:\n\t"
+        "mulx (%[a],%[i],8), %[lo0], %[hi0]\n\t"
+        "mulx 8(%[a],%[i],8), %[lo1], %[hi1]\n\t"
+        "adcx %[carry], %[lo0]\n\t"
+        "adcx %[hi0], %[lo1]\n\t"
+        "mov %[lo0], (%[r],%[i],8)\n\t"
+        "mov %[lo1], 8(%[r],%[i],8)\n\t"
+        "mulx 16(%[a],%[i],8), %[lo0], %[hi0]\n\t"
+        "mulx 24(%[a],%[i],8), %[lo1], %[carry]\n\t"
+        "adcx %[hi1], %[lo0]\n\t"
+        "adcx %[hi0], %[lo1]\n\t"
+        "mov %[lo0], 16(%[r],%[i],8)\n\t"
+        "mov %[lo1], 24(%[r],%[i],8)\n\t"
+        "lea 4(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %k[lo0]\n\t"
+        "adcx %[lo0], %[carry]"
+        : [carry] "+&r"(carry), [i] "+&c"(i), [lo0] "=&r"(lo0), [hi0] "=&r"(hi0), [lo1] "=&r"(lo1),
+          [hi1] "=&r"(hi1)
+        : [r] "r"(r), [a] "r"(a), "d"(b)
+        : "cc", "memory");
+    return carry;
+}
+
+// r[i] comes in on the CF chain and the high limb of the previous product on
+// the OF chain
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    size_t head = n % 4;
+    limb_t carry = portable::addmul_1(r, a, head, b);
+    if (n == head)
+    {
+        return carry;
+    }
+    r += n;
+    a += n;
+    size_t i = head - n;
+    limb_t lo0, hi0, lo1, hi1;
+    __asm__ volatile(
+        "xor %k[lo0], %k[lo0]\n\t"
+        "1:\n\t"
+        "mulx (%[a],%[i],8), %[lo0], %[hi0]\n\t"
+        "mulx 8(%[a],%[i],8), %[lo1], %[hi1]\n\t"
+        "adcx (%[r],%[i],8), %[lo0]\n\t"
+        "adox %[carry], %[lo0]\n\t"
+        "adcx 8(%[r],%[i],8), %[lo1]\n\t"
+        "adox %[hi0], %[lo1]\n\t"
+        "mov %[lo0], (%[r],%[i],8)\n\t"
+        "mov %[lo1], 8(%[r],%[i],8)\n\t"
+        "mulx 16(%[a],%[i],8), %[lo0], %[hi0]\n\t"
+        "mulx 24(%[a],%[i],8), %[lo1], %[carry]\n\t"
+        "adcx 16(%[r],%[i],8), %[lo0]\n\t"
+        "adox %[hi1], %[lo0]\n\t"
+        "adcx 24(%[r],%[i],8), %[lo1]\n\t"
+        "adox %[hi0], %[lo1]\n\t"
+        "mov %[lo0], 16(%[r],%[i],8)\n\t"
+        "mov %[lo1], 24(%[r],%[i],8)\n\t"
+        "lea 4(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %k[lo0]\n\t"
+        "adcx %[lo0], %[carry]\n\t"
+        "adox %[lo0], %[carry]"
+        : [carry] "+&r"(carry), [i] "+&c"(i), [lo0] "=&r"(lo0), [hi0] "=&r"(hi0), [lo1] "=&r"(lo1),
+          [hi1] "=&r"(hi1)
+        : [r] "r"(r), [a] "r"(a), "d"(b)
+        : "cc", "memory");
+    return carry;
+}
+
+void mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    r[an] = mul_1(r, a, an, b[0]);
+    for (size_t i = 1; i != bn; ++i)
+    {
+        r[an + i] = addmul_1(r + i, a, an, b[i]);
+    }
+}
+
+#else
+
+bool supported()
+{
+    return false;
+}
+
+limb_t add_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    return portable::add_n(r, a, b, n);
+}
+
+limb_t sub_n(limb_t* r, limb_t const* a, limb_t const* b, size_t n)
+{
+    return portable::sub_n(r, a, b, n);
+}
+
+limb_t mul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    return portable::mul_1(r, a, n, b);
+}
+
+limb_t addmul_1(limb_t* r, limb_t const* a, size_t n, limb_t b)
+{
+    return portable::addmul_1(r, a, n, b);
+}
+
+void mul_basecase(limb_t* r, limb_t const* a, size_t an, limb_t const* b, size_t bn)
+{
+    portable::mul_basecase(r, a, an, b, bn);
+}
+
+#endif
+}
+}